@@ -0,0 +1,190 @@
+// Copyright 2020 Norwegian University of Science and Technology.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Solver benchmarks on synthetic chessboard problems generated like the
+// examples. Run with --benchmark_out=results.json --benchmark_out_format=json
+// to keep the results, counters included, for comparison between releases.
+
+#include <benchmark/benchmark.h>
+#include <Eigen/Geometry>
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include <eris/batch.hpp>
+#include <eris/solver.hpp>
+
+namespace
+{
+using eris::hand_eye_calibration::BatchOptions;
+using eris::hand_eye_calibration::BatchProblem;
+using eris::hand_eye_calibration::CostFunctionType;
+using eris::hand_eye_calibration::RowMatrixXd;
+using eris::hand_eye_calibration::SolveMethod;
+using eris::hand_eye_calibration::Solver;
+
+// Benchmark arguments are integers, so noise is given in micrometers.
+constexpr double kMicrometer = 1e-6;
+
+struct Problem
+{
+  RowMatrixXd robposes;
+  RowMatrixXd campoints;
+};
+
+auto RandomPose(std::mt19937& generator) -> Eigen::Isometry3d
+{
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  const Eigen::Vector4d q(uniform(generator), uniform(generator), uniform(generator), uniform(generator));
+  Eigen::Isometry3d T = Eigen::Isometry3d::Identity();
+  T.linear() = Eigen::Quaterniond(q(0), q(1), q(2), q(3)).normalized().toRotationMatrix();
+  T.translation() << uniform(generator), uniform(generator), uniform(generator);
+  return T;
+}
+
+// Eye-in-hand problem with num_corners corners of a chessboard with 2 cm
+// squares, ten corners wide, seen from num_poses random robot poses.
+auto MakeProblem(int num_poses, int num_corners, double noise, std::uint32_t seed) -> Problem
+{
+  std::mt19937 generator(seed);
+  std::normal_distribution<double> normal(0.0, noise);
+
+  Eigen::Matrix3Xd P(3, num_corners);
+  for (int k = 0; k < num_corners; ++k)
+  {
+    P.col(k) << 0.02 * (k % 10), 0.02 * (k / 10), 0.0;
+  }
+  const Eigen::Isometry3d T = RandomPose(generator);
+  const Eigen::Isometry3d X = RandomPose(generator);
+
+  Problem problem{ RowMatrixXd(num_poses, 16), RowMatrixXd(num_poses, 3 * num_corners) };
+  for (int i = 0; i < num_poses; ++i)
+  {
+    const Eigen::Isometry3d A = RandomPose(generator);
+    const Eigen::Matrix<double, 4, 4, Eigen::RowMajor> robpose = A.matrix();
+    const Eigen::Matrix3Xd corners = (X.inverse() * A.inverse() * T) * P;
+    problem.robposes.row(i) = Eigen::Map<const Eigen::Matrix<double, 1, 16>>(robpose.data());
+    for (int k = 0; k < num_corners; ++k)
+    {
+      for (int n = 0; n < 3; ++n)
+      {
+        problem.campoints(i, 3 * k + n) = corners(n, k) + (noise > 0.0 ? normal(generator) : 0.0);
+      }
+    }
+  }
+  return problem;
+}
+
+auto AddCounter(benchmark::State& state, const char* name, double value) -> void
+{
+  benchmark::Counter& counter = state.counters[name];
+  counter.flags = benchmark::Counter::kAvgIterations;
+  counter.value += value;
+}
+
+// Storing the poses and selecting the pose pairs.
+auto BM_Construction(benchmark::State& state) -> void
+{
+  const Problem problem = MakeProblem(state.range(0), state.range(1), 0.0, 0);
+  for (auto _ : state)
+  {
+    Solver solver;
+    solver.AddObservations(problem.robposes, problem.campoints);
+    benchmark::DoNotOptimize(solver.NumPairs());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// The first solve of a new problem. Besides the total, the counters split it
+// into building the residual blocks and the initial estimate (setup), and the
+// phases reported by Ceres.
+template <CostFunctionType kCostFunctionType, SolveMethod kSolveMethod>
+auto BM_Solve(benchmark::State& state) -> void
+{
+  const Problem problem = MakeProblem(state.range(0), state.range(1), state.range(2) * kMicrometer, 0);
+  std::optional<Solver> solver;
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    solver.emplace();
+    solver->SetCostFunctionType(kCostFunctionType);
+    solver->SetNumThreads(state.range(3));
+    solver->AddObservations(problem.robposes, problem.campoints);
+    state.ResumeTiming();
+
+    const auto start = std::chrono::steady_clock::now();
+    solver->Solve(kSolveMethod);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const ceres::Solver::Summary summary = solver->Summary();
+    AddCounter(state, "setup_s", seconds - summary.total_time_in_seconds);
+    AddCounter(state, "preprocessor_s", summary.preprocessor_time_in_seconds);
+    AddCounter(state, "residual_evaluation_s", summary.residual_evaluation_time_in_seconds);
+    AddCounter(state, "jacobian_evaluation_s", summary.jacobian_evaluation_time_in_seconds);
+    AddCounter(state, "linear_solver_s", summary.linear_solver_time_in_seconds);
+    AddCounter(state, "minimizer_s", summary.minimizer_time_in_seconds);
+    AddCounter(state, "iterations", summary.num_successful_steps + summary.num_unsuccessful_steps);
+    AddCounter(state, "final_cost", summary.final_cost);
+  }
+}
+
+// Throughput of CalibrateBatch over independent problems.
+auto BM_CalibrateBatch(benchmark::State& state) -> void
+{
+  constexpr int kNumProblems = 64;
+  std::vector<Problem> problems;
+  std::vector<BatchProblem> views;
+  problems.reserve(kNumProblems);
+  for (int k = 0; k < kNumProblems; ++k)
+  {
+    problems.push_back(MakeProblem(state.range(0), state.range(1), state.range(2) * kMicrometer, k));
+    const Problem& problem = problems.back();
+    views.push_back(BatchProblem{ Eigen::Map<const RowMatrixXd>(problem.robposes.data(), problem.robposes.rows(), problem.robposes.cols()),
+                                  Eigen::Map<const RowMatrixXd>(problem.campoints.data(), problem.campoints.rows(), problem.campoints.cols()) });
+  }
+
+  BatchOptions options;
+  options.cost_function_type = CostFunctionType::ANALYTIC;
+  options.num_threads = state.range(3);
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(eris::hand_eye_calibration::CalibrateBatch(views, options));
+  }
+  state.SetItemsProcessed(state.iterations() * kNumProblems);
+}
+
+// Arguments are poses, corners, noise in micrometers and threads.
+auto SolveArguments(benchmark::internal::Benchmark* benchmark) -> void
+{
+  benchmark->ArgNames({ "poses", "corners", "noise_um", "threads" })
+      ->ArgsProduct({ { 10, 30, 100 }, { 12, 60, 240 }, { 0, 1000 }, { 1, 4 } })
+      ->Unit(benchmark::kMillisecond)
+      ->UseRealTime();
+}
+}  // namespace
+
+BENCHMARK(BM_Construction)->ArgNames({ "poses", "corners" })->ArgsProduct({ { 10, 30, 100 }, { 12, 60, 240 } })->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Solve, CostFunctionType::AUTODIFF, SolveMethod::FULL)->Apply(SolveArguments);
+BENCHMARK_TEMPLATE(BM_Solve, CostFunctionType::ANALYTIC, SolveMethod::FULL)->Apply(SolveArguments);
+BENCHMARK_TEMPLATE(BM_Solve, CostFunctionType::ANALYTIC, SolveMethod::SUFFICIENT_STATISTICS)->Apply(SolveArguments);
+BENCHMARK(BM_CalibrateBatch)
+    ->ArgNames({ "poses", "corners", "noise_um", "threads" })
+    ->ArgsProduct({ { 20 }, { 60 }, { 1000 }, { 1, 2, 4, 8 } })
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
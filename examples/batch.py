@@ -0,0 +1,64 @@
+# Copyright 2020 Norwegian University of Science and Technology.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Throughput of solving many independent eye-in-hand problems at once.
+
+import os
+import time
+
+import numpy as np
+np.set_printoptions(suppress=True)
+
+import eris
+from eris.transformations import quaternion_matrix, inverse_matrix
+
+
+def random_pose():
+    q = np.random.rand(4)
+    q /= np.linalg.norm(q)
+    T = quaternion_matrix(q)
+    T[:3, 3] = np.random.rand(3)
+    return T
+
+
+def chessboard_corners(pattern_size=(10, 6), square_size=0.02):
+    pattern_points = np.zeros((np.prod(pattern_size), 4), np.float64)
+    pattern_points[:, :2] = np.indices(pattern_size).T.reshape(-1, 2)
+    pattern_points[:, :2] *= square_size
+    pattern_points[:, -1] += 1.0
+    return pattern_points.T
+
+
+def make_problem(num_samples, noise):
+    P = chessboard_corners()
+    T = random_pose()
+    X = random_pose()
+    Xinv = inverse_matrix(X)
+    robposes = [random_pose() for _ in range(num_samples)]
+    campoints = [(Xinv @ inverse_matrix(A) @ T @ P)[:3, :].T for A in robposes]
+    campoints = [p + np.random.normal(scale=noise, size=p.shape) for p in campoints]
+    return eris.Problem(campoints, robposes), X
+
+
+num_problems = 1000
+np.random.seed(0)
+problems, Xs = zip(*[make_problem(10, 0.001) for _ in range(num_problems)])
+
+for threads in sorted({1, 2, 4, os.cpu_count()}):
+    start = time.perf_counter()
+    sols, statistics = eris.calibrate_batch(problems, threads=threads, analytic_jacobian=True)
+    elapsed = time.perf_counter() - start
+    errors = [np.linalg.norm((X @ inverse_matrix(sol))[:3, 3]) for X, sol in zip(Xs, sols)]
+    print("threads: {:3d}  problems/s: {:8.1f}  converged: {:4d}  median error: {:.2e}".format(
+        threads, num_problems / elapsed, int(statistics["converged"].sum()), np.median(errors)))
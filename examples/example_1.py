@@ -18,7 +18,7 @@ campoints = [
 ]
 
 problem = eris.Problem(campoints, robposes)
-solver = eris.Solver()
+solver = eris.Solver(full_report=True)
 
 sol, summary = solver.calibrate_eye_to_hand(problem)
 
@@ -0,0 +1,111 @@
+# Copyright 2020 Norwegian University of Science and Technology.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Accuracy against runtime of the pose pair strategies on synthetic eye-in-hand data.
+
+import time
+
+import numpy as np
+np.set_printoptions(suppress=True)
+
+import eris
+from eris.transformations import quaternion_matrix, inverse_matrix, rotation_from_matrix
+
+
+def random_pose():
+    q = np.random.rand(4)
+    q /= np.linalg.norm(q)
+    T = quaternion_matrix(q)
+    T[:3, 3] = np.random.rand(3)
+    return T
+
+
+def chessboard_corners(pattern_size=(10, 6), square_size=0.02):
+    pattern_points = np.zeros((np.prod(pattern_size), 4), np.float64)
+    pattern_points[:, :2] = np.indices(pattern_size).T.reshape(-1, 2)
+    pattern_points[:, :2] *= square_size
+    pattern_points[:, -1] += 1.0
+    return pattern_points.T
+
+
+def make_problem(num_samples, noise):
+    P = chessboard_corners()
+    T = random_pose()
+    X = random_pose()
+    Xinv = inverse_matrix(X)
+    robposes = [random_pose() for _ in range(num_samples)]
+    campoints = [(Xinv @ inverse_matrix(A) @ T @ P)[:3, :].T for A in robposes]
+    campoints = [p + np.random.normal(scale=noise, size=p.shape) for p in campoints]
+    return eris.Problem(campoints, robposes), X
+
+
+def errors(X, sol):
+    E = inverse_matrix(X) @ sol
+    angle, _, _ = rotation_from_matrix(E)
+    return np.degrees(abs(angle)), np.linalg.norm(E[:3, 3])
+
+
+strategies = [
+    ("all", {}),
+    ("consecutive", {}),
+    ("k_nearest", {"k": 5}),
+    ("random", {"num_pairs": 500, "seed": 1}),
+    ("reference", {}),
+]
+
+num_samples = 100
+noise = 0.001
+num_trials = 5
+
+solver = eris.Solver(analytic_jacobian=True)
+
+results = []
+for name, options in strategies:
+    runtimes, rotation_errors, translation_errors = [], [], []
+    for trial in range(num_trials):
+        np.random.seed(trial)
+        problem, X = make_problem(num_samples, noise)
+        start = time.perf_counter()
+        sol, summary = solver.calibrate_eye_in_hand(problem, pairs=name, **options)
+        runtimes.append(time.perf_counter() - start)
+        rotation_error, translation_error = errors(X, sol)
+        rotation_errors.append(rotation_error)
+        translation_errors.append(translation_error)
+    results.append((name, summary["num_pose_pairs"], summary["estimated_memory_in_bytes"], np.median(runtimes),
+                    np.median(rotation_errors), np.median(translation_errors)))
+
+print("{:<12} {:>8} {:>10} {:>10} {:>12} {:>12}".format("strategy", "pairs", "memory MB", "time s", "rot err deg", "trans err m"))
+for name, num_pairs, memory, runtime, rotation_error, translation_error in results:
+    print("{:<12} {:>8} {:>10.1f} {:>10.4f} {:>12.5f} {:>12.6f}".format(name, num_pairs, memory / 1e6, runtime, rotation_error,
+                                                                        translation_error))
+
+try:
+    import matplotlib.pyplot as plt
+except ImportError:
+    plt = None
+
+if plt is not None:
+    fig, axes = plt.subplots(1, 2, figsize=(10, 4))
+    for name, num_pairs, memory, runtime, rotation_error, translation_error in results:
+        axes[0].scatter(runtime, rotation_error, label=name)
+        axes[1].scatter(runtime, translation_error, label=name)
+    axes[0].set_xlabel("runtime [s]")
+    axes[0].set_ylabel("rotation error [deg]")
+    axes[1].set_xlabel("runtime [s]")
+    axes[1].set_ylabel("translation error [m]")
+    for ax in axes:
+        ax.set_xscale("log")
+        ax.legend()
+    fig.tight_layout()
+    fig.savefig("pair_strategies.png")
@@ -0,0 +1,130 @@
+// Copyright 2020 Norwegian University of Science and Technology.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace eris
+{
+// Chunked object arena. Objects are constructed in place in large contiguous
+// chunks, never move once created and are all destroyed together with the arena.
+template <typename T>
+class Arena
+{
+public:
+  explicit Arena(std::size_t chunk_size = 1024) : chunk_size_(std::max<std::size_t>(chunk_size, 1))
+  {
+  }
+
+  Arena(const Arena&) = delete;
+  auto operator=(const Arena&) -> Arena& = delete;
+
+  ~Arena()
+  {
+    Clear();
+  }
+
+  // Ensures that the next n calls to Create are served from a single chunk.
+  auto Reserve(std::size_t n) -> void
+  {
+    while (current_ < chunks_.size() && chunks_[current_].capacity - chunks_[current_].size < n)
+    {
+      ++current_;
+    }
+    if (current_ == chunks_.size())
+    {
+      AllocateChunk(std::max(n, chunk_size_));
+    }
+  }
+
+  template <typename... Args>
+  auto Create(Args&&... args) -> T*
+  {
+    Reserve(1);
+    Chunk& chunk = chunks_[current_];
+    T* object = new (chunk.data + chunk.size) T(std::forward<Args>(args)...);
+    ++chunk.size;
+    ++size_;
+    return object;
+  }
+
+  auto Size() const -> std::size_t
+  {
+    return size_;
+  }
+
+  // Returns the object created by the index-th call to Create.
+  auto At(std::size_t index) -> T*
+  {
+    for (Chunk& chunk : chunks_)
+    {
+      if (index < chunk.size)
+      {
+        return chunk.data + index;
+      }
+      index -= chunk.size;
+    }
+    return nullptr;
+  }
+
+  // Destroys every object but keeps the chunks for the objects created next.
+  auto Reset() -> void
+  {
+    for (Chunk& chunk : chunks_)
+    {
+      for (std::size_t i = 0; i < chunk.size; ++i)
+      {
+        chunk.data[i].~T();
+      }
+      chunk.size = 0;
+    }
+    current_ = 0;
+    size_ = 0;
+  }
+
+  auto Clear() -> void
+  {
+    Reset();
+    for (Chunk& chunk : chunks_)
+    {
+      ::operator delete(chunk.data, std::align_val_t(alignof(T)));
+    }
+    chunks_.clear();
+  }
+
+private:
+  struct Chunk
+  {
+    T* data;
+    std::size_t size;
+    std::size_t capacity;
+  };
+
+  auto AllocateChunk(std::size_t capacity) -> void
+  {
+    T* data = static_cast<T*>(::operator new(capacity * sizeof(T), std::align_val_t(alignof(T))));
+    chunks_.push_back(Chunk{ data, 0, capacity });
+  }
+
+  std::size_t chunk_size_;
+  std::size_t size_ = 0;
+  std::size_t current_ = 0;
+  std::vector<Chunk> chunks_;
+};
+}  // namespace eris
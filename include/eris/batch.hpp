@@ -0,0 +1,70 @@
+// Copyright 2020 Norwegian University of Science and Technology.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <Eigen/Core>
+
+#include <vector>
+
+#include <eris/observations.hpp>
+#include <eris/outliers.hpp>
+#include <eris/pairs.hpp>
+#include <eris/solver.hpp>
+
+namespace eris::hand_eye_calibration
+{
+struct BatchOptions
+{
+  SolveMethod method = SolveMethod::FULL;
+  CostFunctionType cost_function_type = CostFunctionType::AUTODIFF;
+  PairOptions pair_options;
+  LossType loss_type = LossType::TRIVIAL;
+  double loss_scale = 1.0;
+  OutlierOptions outlier_options;
+  SolverOptions solver_options;
+  // Values <= 0 select the hardware concurrency.
+  int num_threads = 0;
+};
+
+// The observations of one problem, laid out as for Solver::AddObservations.
+struct BatchProblem
+{
+  Eigen::Map<const RowMatrixXd> robposes;
+  Eigen::Map<const RowMatrixXd> campoints;
+};
+
+// One row per problem. Problems that could not be solved have NaN solutions
+// and costs and are not marked as converged.
+struct BatchResult
+{
+  // Rotations as unit quaternions (w, x, y, z).
+  RowMatrixXd q;
+  RowMatrixXd t;
+  Eigen::VectorXd initial_cost;
+  Eigen::VectorXd final_cost;
+  Eigen::VectorXi num_iterations;
+  Eigen::VectorXi num_pairs;
+  // Wall time spent building and solving the problem.
+  Eigen::VectorXd time_in_seconds;
+  Eigen::Matrix<bool, Eigen::Dynamic, 1> converged;
+};
+
+// Solves independent problems concurrently, each single-threaded and starting
+// from the closed-form initializer. Every thread reuses one Solver, and with
+// it the memory of its cost functions, for all the problems it picks up.
+// Invalid options throw std::invalid_argument as the Solver setters do,
+// before any problem is solved.
+auto CalibrateBatch(const std::vector<BatchProblem>& problems, const BatchOptions& options) -> BatchResult;
+}  // namespace eris::hand_eye_calibration
@@ -0,0 +1,56 @@
+// Copyright 2020 Norwegian University of Science and Technology.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <Eigen/Core>
+
+#include <vector>
+
+#include <eris/observations.hpp>
+
+namespace eris::hand_eye_calibration
+{
+// The robot motion A = Ti^-1 Tj of a pose pair and the camera motion B, with
+// pi = B pj, fitted to the corners with Umeyama's method. alpha and beta are
+// the rotation vectors of A and B.
+struct Motion
+{
+  Eigen::Matrix3d RA;
+  Eigen::Vector3d tA;
+  Eigen::Matrix3d RB;
+  Eigen::Vector3d tB;
+  Eigen::Vector3d alpha;
+  Eigen::Vector3d beta;
+  bool valid = false;
+};
+
+// Not valid if the poses share fewer than three corners.
+auto PairMotion(const Pose& pose_i, const Pose& pose_j) -> Motion;
+
+// Closed-form estimate of the hand-eye transform X from AX = XB (Park and
+// Martin, 1994) over motions[indices]. The rotation follows from aligning the
+// rotation axes of A and B, and the translation from linear least squares.
+// Motions whose rotation is close to the identity carry no rotation
+// information and are skipped.
+//
+// Returns false, leaving q and t untouched, if there are not at least two
+// motions with non-parallel rotation axes.
+auto ParkMartin(const std::vector<Motion>& motions, const std::vector<int>& indices, Eigen::Vector4d* q, Eigen::Vector3d* t) -> bool;
+
+// The same estimate over the given pose pairs, computing their motions in
+// parallel.
+auto ParkMartin(const std::vector<Pose>& poses, const std::vector<PosePair>& pairs, int num_threads, Eigen::Vector4d* q, Eigen::Vector3d* t)
+    -> bool;
+}  // namespace eris::hand_eye_calibration
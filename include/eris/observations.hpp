@@ -0,0 +1,39 @@
+// Copyright 2020 Norwegian University of Science and Technology.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <Eigen/Core>
+
+#include <utility>
+
+namespace eris::hand_eye_calibration
+{
+using RowMatrixXd = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+using PosePair = std::pair<int, int>;
+
+// Points stored as a structure of arrays: the x, y and z coordinates of all
+// points are each contiguous in memory.
+using Points = Eigen::Matrix<double, Eigen::Dynamic, 3>;
+
+// A robot pose together with the calibration object corners seen from it.
+struct Pose
+{
+  // Rotation as a unit quaternion (w, x, y, z), the order used by Ceres.
+  Eigen::Vector4d q;
+  Eigen::Matrix3d R;
+  Eigen::Vector3d t;
+  Points points;
+};
+}  // namespace eris::hand_eye_calibration
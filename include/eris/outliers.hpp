@@ -0,0 +1,73 @@
+// Copyright 2020 Norwegian University of Science and Technology.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <Eigen/Core>
+
+#include <cstdint>
+#include <vector>
+
+#include <eris/observations.hpp>
+
+namespace eris::hand_eye_calibration
+{
+enum class OutlierRejection
+{
+  NONE,
+  // Keeps the hypothesis with the lowest truncated quadratic cost (MSAC).
+  RANSAC,
+  // Keeps the hypothesis with the lowest median squared residual, and derives
+  // the inlier threshold from it.
+  LMEDS,
+};
+
+struct OutlierOptions
+{
+  OutlierRejection method = OutlierRejection::NONE;
+  // Number of minimal samples of two pose pairs.
+  int num_samples = 500;
+  // RMS corner residual of a pose pair, in the units of the points, below
+  // which the pair is an inlier. Only used by RANSAC.
+  double threshold = 0.01;
+  // Poses with a smaller fraction of inlier pairs are outliers.
+  double min_inlier_ratio = 0.5;
+  std::uint32_t seed = 0;
+};
+
+// Per pose and per pair, in the order they were added. Poses and pairs that
+// were already dropped are outliers, and their residuals are NaN. Other poses
+// in no scored pair are inliers with NaN residuals.
+struct OutlierSummary
+{
+  Eigen::Matrix<bool, Eigen::Dynamic, 1> pose_inliers;
+  Eigen::Matrix<bool, Eigen::Dynamic, 1> pair_inliers;
+  // RMS corner residual of each pair and its median and maximum over the
+  // pairs of each pose, under the estimate refitted to the inliers.
+  Eigen::VectorXd pair_residuals;
+  Eigen::VectorXd pose_residual_median;
+  Eigen::VectorXd pose_residual_max;
+  double threshold = 0.0;
+  Eigen::Vector4d q{ 1.0, 0.0, 0.0, 0.0 };
+  Eigen::Vector3d t = Eigen::Vector3d::Zero();
+};
+
+// Scores closed-form ParkMartin estimates from random pairs of pose pairs in
+// parallel and classifies poses and pairs under the best one. Each pair is
+// scored through its own Gram matrix, so a hypothesis costs O(1) per pair
+// regardless of the number of corners. Returns false if no sample yields an
+// estimate.
+auto RejectOutliers(const std::vector<Pose>& poses, const std::vector<PosePair>& pairs, const OutlierOptions& options, int num_threads,
+                    OutlierSummary* summary) -> bool;
+}  // namespace eris::hand_eye_calibration
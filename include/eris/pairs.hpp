@@ -0,0 +1,69 @@
+// Copyright 2020 Norwegian University of Science and Technology.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <eris/observations.hpp>
+
+namespace eris::hand_eye_calibration
+{
+enum class PairStrategy
+{
+  // Every pair (i, j), i < j. Grows quadratically with the number of poses.
+  ALL,
+  // Pairs of poses that follow each other in the input order.
+  CONSECUTIVE,
+  // Each pose paired with its k nearest neighbours in pose space.
+  K_NEAREST,
+  // A uniform random subset of all pairs.
+  RANDOM,
+  // Every pose paired with a single reference pose.
+  REFERENCE,
+};
+
+struct PairOptions
+{
+  PairStrategy strategy = PairStrategy::ALL;
+
+  // K_NEAREST: number of neighbours per pose. RANDOM: number of partners of
+  // each pose added incrementally.
+  int k = 5;
+
+  // K_NEAREST: weight of the rotation angle in radians against the
+  // translation distance when measuring the distance between poses.
+  double rotation_weight = 1.0;
+
+  // RANDOM: number of pairs to draw and the seed of the generator.
+  int num_pairs = 1000;
+  std::uint32_t seed = 0;
+
+  // REFERENCE: index of the reference pose.
+  int reference = 0;
+};
+
+// Selects pose pairs among poses[begin, end). The returned pairs (i, j) have
+// i < j, hold indices into poses and contain no duplicates. The reference
+// pose is counted from begin.
+auto SelectPairs(const std::vector<Pose>& poses, int begin, int end, const PairOptions& options) -> std::vector<PosePair>;
+
+// Selects the pairs (i, index) that connect a newly added pose to the earlier
+// poses[begin, index), for incremental calibration. ALL connects it to every
+// earlier pose, CONSECUTIVE to the previous one, K_NEAREST to its k nearest,
+// RANDOM to k randomly drawn ones and REFERENCE to the reference pose. Earlier
+// poses without points, which were dropped from the window, are skipped.
+auto SelectPairsForNewPose(const std::vector<Pose>& poses, int begin, int index, const PairOptions& options) -> std::vector<PosePair>;
+}  // namespace eris::hand_eye_calibration
@@ -0,0 +1,91 @@
+// Copyright 2020 Norwegian University of Science and Technology.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace eris
+{
+// Number of threads to use when the caller asks for num_threads <= 0.
+inline auto DefaultNumThreads() -> int
+{
+  return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+// Calls function(thread_id, i) for every i in [begin, end) on up to
+// num_threads threads. Indices are handed out dynamically so uneven work is
+// balanced, and thread_id in [0, num_threads) can index per-thread state.
+// The first exception thrown by function is rethrown on the calling thread.
+template <typename Function>
+auto ParallelFor(int begin, int end, int num_threads, Function&& function) -> void
+{
+  if (num_threads <= 0)
+  {
+    num_threads = DefaultNumThreads();
+  }
+  num_threads = std::min(num_threads, end - begin);
+  if (num_threads <= 1)
+  {
+    for (int i = begin; i < end; ++i)
+    {
+      function(0, i);
+    }
+    return;
+  }
+
+  std::atomic<int> next(begin);
+  std::exception_ptr exception;
+  std::mutex exception_mutex;
+  auto worker = [&](int thread_id) {
+    for (int i = next++; i < end; i = next++)
+    {
+      try
+      {
+        function(thread_id, i);
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lock(exception_mutex);
+        if (!exception)
+        {
+          exception = std::current_exception();
+        }
+        next = end;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads - 1);
+  for (int thread_id = 1; thread_id < num_threads; ++thread_id)
+  {
+    threads.emplace_back(worker, thread_id);
+  }
+  worker(0);
+  for (std::thread& thread : threads)
+  {
+    thread.join();
+  }
+  if (exception)
+  {
+    std::rethrow_exception(exception);
+  }
+}
+}  // namespace eris
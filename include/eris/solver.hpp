@@ -19,7 +19,21 @@
 #include <Eigen/Core>
 
 #include <glog/logging.h>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <eris/arena.hpp>
+#include <eris/initialization.hpp>
+#include <eris/observations.hpp>
+#include <eris/outliers.hpp>
+#include <eris/pairs.hpp>
+#include <eris/sufficient_statistics.hpp>
+#include <eris/telemetry.hpp>
 
 namespace eris::hand_eye_calibration
 {
@@ -79,30 +93,367 @@ private:
   const Eigen::Vector3d pj_;
 };
 
+// Forward-mode automatic differentiation of a functor with two parameter
+// blocks. Unlike ceres::AutoDiffCostFunction the functor is borrowed, which
+// lets the solver keep all functors in a single arena.
+template <typename Functor, int kNumResiduals, int N0, int N1>
+class BorrowedAutoDiffCostFunction : public ceres::SizedCostFunction<kNumResiduals, N0, N1>
+{
+public:
+  explicit BorrowedAutoDiffCostFunction(const Functor* functor) : functor_(functor)
+  {
+  }
+
+  auto Evaluate(double const* const* parameters, double* residuals, double** jacobians) const -> bool override
+  {
+    if (jacobians == nullptr)
+    {
+      return (*functor_)(parameters[0], parameters[1], residuals);
+    }
+
+    using Jet = ceres::Jet<double, N0 + N1>;
+    Jet x0[N0];
+    Jet x1[N1];
+    Jet r[kNumResiduals];
+    for (int i = 0; i < N0; ++i)
+    {
+      x0[i] = Jet(parameters[0][i], i);
+    }
+    for (int i = 0; i < N1; ++i)
+    {
+      x1[i] = Jet(parameters[1][i], N0 + i);
+    }
+    if (!(*functor_)(x0, x1, r))
+    {
+      return false;
+    }
+
+    for (int k = 0; k < kNumResiduals; ++k)
+    {
+      residuals[k] = r[k].a;
+      if (jacobians[0] != nullptr)
+      {
+        for (int i = 0; i < N0; ++i)
+        {
+          jacobians[0][k * N0 + i] = r[k].v[i];
+        }
+      }
+      if (jacobians[1] != nullptr)
+      {
+        for (int i = 0; i < N1; ++i)
+        {
+          jacobians[1][k * N1 + i] = r[k].v[N0 + i];
+        }
+      }
+    }
+    return true;
+  }
+
+private:
+  const Functor* functor_;
+};
+
+// Analytic-Jacobian cost function for all corners seen from a pose pair (i, j).
+// Evaluates the same residuals as CostFunctor, three per corner, with the
+// robot rotations precomputed as matrices. The 3M residuals of M corners are
+// only known per problem, so this is a ceres::CostFunction sized at runtime
+// rather than a ceres::SizedCostFunction.
+class PairCostFunction : public ceres::CostFunction
+{
+public:
+  PairCostFunction(const Eigen::Matrix3d& Ri, const Eigen::Vector3d& ti, const Points& pi, const Eigen::Matrix3d& Rj, const Eigen::Vector3d& tj,
+                   const Points& pj);
+
+  auto Evaluate(double const* const* parameters, double* residuals, double** jacobians) const -> bool override;
+
+private:
+  const Eigen::Matrix3d Ri_;
+  const Eigen::Vector3d ti_;
+  const Points pi_;
+  const Eigen::Matrix3d Rj_;
+  const Eigen::Vector3d tj_;
+  const Points pj_;
+};
+
+enum class CostFunctionType
+{
+  AUTODIFF,
+  ANALYTIC,
+};
+
+enum class SolveMethod
+{
+  // Minimize over all residual blocks.
+  FULL,
+  // Minimize the equivalent 13x13 quadratic form accumulated from the data.
+  SUFFICIENT_STATISTICS,
+};
+
+enum class LossType
+{
+  TRIVIAL,
+  HUBER,
+  CAUCHY,
+  TUKEY,
+};
+
+struct SolverOptions
+{
+  // Chosen from the number of residuals when not set: DENSE_QR for small
+  // problems and DENSE_NORMAL_CHOLESKY for the tall, thin Jacobians of large
+  // ones, which only have seven parameters.
+  std::optional<ceres::LinearSolverType> linear_solver_type;
+  // Threads used by Ceres to evaluate residuals and Jacobians. Values <= 0
+  // use one thread per kResidualsPerThread residuals, at most the number of
+  // residual blocks and the solver's own thread count.
+  int num_threads = 0;
+  int max_num_iterations = 50;
+  double function_tolerance = 1e-6;
+  double gradient_tolerance = 1e-10;
+  double parameter_tolerance = 1e-8;
+  double max_solver_time_in_seconds = 1e9;
+  // Records the iterations of every Solve for Solver::Telemetry.
+  bool telemetry = true;
+
+  static constexpr int kResidualsPerThread = 3000;
+  static constexpr int kMaxDenseQrResiduals = 3000;
+};
+
+// Outcome of Solver::SolveMultiStart.
+struct MultiStartSummary
+{
+  // Index of the start with the lowest final cost.
+  int best = -1;
+  std::vector<Eigen::Vector4d> q;
+  std::vector<Eigen::Vector3d> t;
+  std::vector<double> final_cost;
+  // Largest rotation angle, in degrees, and translation distance between any
+  // start's solution and the best one.
+  double rotation_spread = 0.0;
+  double translation_spread = 0.0;
+};
+
+// The public methods may be called from several threads and run one at a
+// time, except Telemetry, which can be read while a solve runs.
 class Solver
 {
 public:
-  Solver(const Eigen::Vector4d& q_init, const Eigen::Vector3d t_init) : q_opt_(q_init), t_opt_(t_init)
+  // Starts from the closed-form ParkMartin estimate, computed on the first solve
+  // with enough rotational motion between the poses.
+  Solver() : problem_(std::make_unique<ceres::Problem>(ProblemOptions())), q_opt_(1.0, 0.0, 0.0, 0.0), t_opt_(Eigen::Vector3d::Zero())
+  {
+    needs_initialization_ = true;
+  }
+
+  Solver(const Eigen::Vector4d& q_init, const Eigen::Vector3d t_init)
+    : problem_(std::make_unique<ceres::Problem>(ProblemOptions())), q_opt_(q_init), t_opt_(t_init)
   {
   }
 
   auto AddResidualBlock(const Eigen::Vector4d&, const Eigen::Vector3d&, const Eigen::Vector3d&, const Eigen::Vector4d&, const Eigen::Vector3d&,
                         const Eigen::Vector3d&) -> bool;
 
-  auto Solve() -> std::tuple<Eigen::Vector4d, Eigen::Vector3d>;
+  // Drops every observation and returns to the closed-form initial estimate,
+  // keeping the settings and the memory already allocated for cost functions
+  // so the solver can be reused for an unrelated problem.
+  auto Reset() -> void;
+
+  // Adds the residuals of the pose pairs chosen by the pair options, all
+  // pairs (i, j), i < j, by default, in one call. robposes is N x 16 with one
+  // row-major 4x4 robot pose per row and campoints is N x 3M with the M
+  // corners seen from each pose.
+  auto AddObservations(const Eigen::Ref<const RowMatrixXd>& robposes, const Eigen::Ref<const RowMatrixXd>& campoints) -> bool;
+
+  // Adds the residuals of the given pose pairs only. Pair indices refer to the
+  // rows of robposes.
+  auto AddObservations(const Eigen::Ref<const RowMatrixXd>& robposes, const Eigen::Ref<const RowMatrixXd>& campoints,
+                       const std::vector<PosePair>& pairs) -> bool;
+
+  // Adds a single robot pose and the M x 3 points seen from it, paired with
+  // the poses already in the window according to the pair options. Only the
+  // new pairs are added to the problem on the next solve.
+  auto AddPose(const Eigen::Matrix4d& robpose, const Eigen::Ref<const RowMatrixXd>& campoints) -> bool;
+
+  // Keeps at most max_poses poses, evicting the oldest ones together with
+  // their pairs as new poses arrive. Values <= 0 keep every pose. The
+  // reference pose of the REFERENCE pair strategy is never evicted.
+  auto SetMaxPoses(int max_poses) -> void;
+
+  // Number of poses in the window.
+  auto NumPoses() const -> int;
+
+  // Selects how pose pairs are formed by subsequent calls to AddObservations
+  // without explicit pairs and to AddPose. Throws std::invalid_argument if k
+  // < 1, num_pairs < 0 or reference < 0.
+  auto SetPairOptions(const PairOptions& options) -> void;
+
+  // Number of pose pairs in the window.
+  auto NumPairs() const -> int;
+
+  // Rough size of the stored observations, the residual blocks and the
+  // Jacobian of a FULL solve.
+  auto EstimatedMemoryInBytes() const -> std::size_t;
+
+  // Selects the cost function used for residual blocks that have not been
+  // built yet. AUTODIFF adds one CostFunctor block per corner, ANALYTIC one
+  // PairCostFunction block per pose pair.
+  auto SetCostFunctionType(CostFunctionType type) -> void;
+
+  // Number of threads used to accumulate the sufficient statistics, where
+  // values <= 0 select the hardware concurrency.
+  auto SetNumThreads(int num_threads) -> void;
+
+  // Robust loss whose scale is a corner residual under both cost function
+  // types. AUTODIFF applies it to every corner and ANALYTIC to the RMS corner
+  // residual of every pose pair, weighted by its M corners, through the same
+  // loss with scale * sqrt(M). Only the FULL solve method supports losses
+  // other than TRIVIAL.
+  auto SetLossFunction(LossType type, double scale = 1.0) -> void;
+
+  auto SetOptions(const SolverOptions& options) -> void;
+
+  // Iterations of the current or last Solve, safe to call while it runs.
+  auto Telemetry() const -> std::vector<IterationRecord>;
+
+  // Enables rejection of outlier poses and pairs before every solve. Poses
+  // classified as outliers are dropped together with their pairs, as if
+  // evicted, and so are outlier pairs between inlier poses. Throws
+  // std::invalid_argument unless num_samples >= 1, threshold > 0 and
+  // min_inlier_ratio is in [0, 1].
+  auto SetOutlierOptions(const OutlierOptions& options) -> void;
+
+  // Pose and pair classification of the last outlier rejection. Its indices
+  // refer to the poses and pairs held at the time, in the order they were
+  // added, before evicted and rejected ones were compacted away.
+  auto OutlierSummary() const -> hand_eye_calibration::OutlierSummary;
+
+  // Residual blocks for the observations are built on the first FULL solve
+  // and the Gram matrix on the first SUFFICIENT_STATISTICS solve. Both are
+  // only extended with new pose pairs afterwards, and every solve starts
+  // from the estimate of the previous one.
+  auto Solve(SolveMethod method = SolveMethod::FULL) -> std::tuple<Eigen::Vector4d, Eigen::Vector3d>;
+
+  // Runs num_starts independent refinements concurrently and keeps the one
+  // with the lowest final cost. The first start is the current estimate and
+  // the others use uniformly random rotations drawn from seed. Summary
+  // returns the summary of the best start.
+  auto SolveMultiStart(int num_starts, SolveMethod method = SolveMethod::FULL, std::uint32_t seed = 0)
+      -> std::tuple<Eigen::Vector4d, Eigen::Vector3d>;
+
+  auto MultiStartSummary() const -> hand_eye_calibration::MultiStartSummary;
 
   auto Summary() -> ceres::Solver::Summary;
 
+  // The Ceres options of the last solve, with the automatic choices made.
   auto Options() -> ceres::Solver::Options;
 
 private:
-  ceres::Problem problem_;
+  using CostFunction = BorrowedAutoDiffCostFunction<CostFunctor, 3, 4, 3>;
+
+  static auto ProblemOptions() -> ceres::Problem::Options;
+
+  auto WindowSize() const -> int;
+  auto AppendPoses(const Eigen::Ref<const RowMatrixXd>& robposes, const Eigen::Ref<const RowMatrixXd>& campoints) -> int;
+  auto AddPair(int i, int j) -> void;
+  auto AddReferencePairs(int index) -> void;
+  auto SetReferencePose(int index) -> void;
+  auto IsActive(const PosePair& pair) const -> bool;
+  auto DropPair(int index) -> void;
+  auto DropPose(int index) -> void;
+  auto ErasePairs(const std::vector<bool>& keep) -> void;
+  auto EvictPoses() -> void;
+  auto RejectOutliers() -> void;
+  auto RebuildProblem() -> void;
+  auto CompactWindow() -> void;
+  auto RebuildProblemIfSparse() -> void;
+  auto BuildResidualBlocks() -> void;
+  auto UpdateGram() -> void;
+  auto Initialize() -> void;
+
+  // Sets options_ from options for a problem of the given size.
+  // Loss of the ANALYTIC blocks, created once the number of corners is known.
+  auto PairLossFunction() -> ceres::LossFunction*;
+
+  auto ConfigureOptions(int num_residuals, int num_residual_blocks) -> void;
+
+  // Adds every live cost function to problem, with q and t as parameters.
+  auto AddResidualBlocksTo(ceres::Problem* problem, double* q, double* t) -> void;
+
+  // Minimizes the sufficient statistics starting from q and t.
+  auto SolveGram(const ceres::Solver::Options& options, double* q, double* t, ceres::Solver::Summary* summary) const -> void;
+
+  struct Block
+  {
+    ceres::ResidualBlockId id;
+    ceres::CostFunction* cost_function;
+    ceres::LossFunction* loss_function;
+  };
+
+  // Evicted and rejected poses keep their pose but drop their points, and the
+  // pairs that refer to them are inactive, until the next rebuild removes
+  // them. Poses in [first_pose_, poses_.size()) and the reference pose are in
+  // the window.
+  std::vector<Pose> poses_;
+  std::vector<std::vector<int>> pose_pairs_;
+  std::vector<PosePair> pairs_;
+  std::vector<std::vector<Block>> pair_blocks_;
+  PairOptions pair_options_;
+  Eigen::Index num_points_ = -1;
+  int first_pose_ = 0;
+  int max_poses_ = 0;
+  int num_active_pairs_ = 0;
+  std::size_t num_pairs_in_problem_ = 0;
+  std::size_t num_pairs_in_gram_ = 0;
+  std::size_t num_evicted_blocks_ = 0;
+
+  // Pose that every new pose is paired with under the REFERENCE strategy, or
+  // -1. It stays when the window moves past it.
+  int reference_pose_ = -1;
+
+  // Sufficient statistics of the active pairs and of the blocks added through
+  // AddResidualBlock, and of the latter alone.
+  GramMatrix gram_ = GramMatrix::Zero();
+  GramMatrix loose_gram_ = GramMatrix::Zero();
+
+  int num_threads_ = 0;
+
+  // The arenas own every cost function in problem_ and must outlive it. Blocks
+  // added through AddResidualBlock live in their own arenas, which survive
+  // rebuilding the problem.
+  Arena<CostFunctor> functors_;
+  Arena<CostFunction> cost_functions_;
+  Arena<PairCostFunction> pair_cost_functions_;
+  Arena<CostFunctor> loose_functors_;
+  Arena<CostFunction> loose_cost_functions_;
+
+  CostFunctionType cost_function_type_ = CostFunctionType::AUTODIFF;
+
+  // Shared by every residual block of a corner, and by every block of a pose
+  // pair.
+  LossType loss_type_ = LossType::TRIVIAL;
+  double loss_scale_ = 1.0;
+  std::unique_ptr<ceres::LossFunction> loss_function_;
+  std::unique_ptr<ceres::LossFunction> pair_loss_function_;
+
+  OutlierOptions outlier_options_;
+  hand_eye_calibration::OutlierSummary outlier_summary_;
+
+  std::unique_ptr<ceres::Problem> problem_;
+  SolverOptions solver_options_;
   ceres::Solver::Options options_;
   ceres::Solver::Summary summary_;
+  hand_eye_calibration::Telemetry telemetry_;
+
+  hand_eye_calibration::MultiStartSummary multi_start_summary_;
+
+  // Taken by every public method but Telemetry, so that a solve running on
+  // another thread is never modified under Ceres.
+  mutable std::mutex mutex_;
 
   bool local_parameterization_is_set_ = false;
+  bool needs_initialization_ = false;
 
   Eigen::Vector4d q_opt_;
   Eigen::Vector3d t_opt_;
 };
-}  // namespace eris::hand_eye_calibration
\ No newline at end of file
+}  // namespace eris::hand_eye_calibration
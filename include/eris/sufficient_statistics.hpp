@@ -0,0 +1,83 @@
+// Copyright 2020 Norwegian University of Science and Technology.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <ceres/rotation.h>
+#include <Eigen/Core>
+
+#include <cstddef>
+#include <vector>
+
+#include <eris/observations.hpp>
+
+namespace eris::hand_eye_calibration
+{
+// The residual of a corner pair is linear in z = [vec(R_x); t_x; 1], where
+// vec stacks the columns of R_x, so the total cost is the quadratic form
+// 0.5 z^T G z. The Gram matrix G is all the solver needs to know about the data.
+using GramMatrix = Eigen::Matrix<double, 13, 13>;
+
+// Returns M with residual = M z for a single corner pair.
+auto CornerDesignMatrix(const Eigen::Matrix3d& Ri, const Eigen::Vector3d& ti, const Eigen::Vector3d& pi, const Eigen::Matrix3d& Rj,
+                        const Eigen::Vector3d& tj, const Eigen::Vector3d& pj) -> Eigen::Matrix<double, 3, 13>;
+
+// Sums the Gram matrices of pairs[begin, end) with a parallel reduction over
+// the pose pairs.
+auto AccumulateGram(const std::vector<Pose>& poses, const std::vector<PosePair>& pairs, std::size_t begin, std::size_t end, int num_threads)
+    -> GramMatrix;
+
+// Evaluates the cost 0.5 z^T G z as 0.5 |S z|^2 with S^T S = G, so the
+// minimization over (q_x, t_x) costs the same regardless of the number of
+// residuals that went into G.
+class GramCostFunctor
+{
+public:
+  explicit GramCostFunctor(const GramMatrix& gram);
+
+  template <typename T>
+  auto operator()(const T* const qx, const T* const tx, T* residual) const -> bool
+  {
+    // Row-major rotation matrix, normalizing qx.
+    T R[9];
+    ceres::QuaternionToRotation(qx, R);
+
+    T z[13];
+    for (int c = 0; c < 3; ++c)
+    {
+      for (int r = 0; r < 3; ++r)
+      {
+        z[3 * c + r] = R[3 * r + c];
+      }
+    }
+    z[9] = tx[0];
+    z[10] = tx[1];
+    z[11] = tx[2];
+    z[12] = T(1.0);
+
+    for (int i = 0; i < 13; ++i)
+    {
+      residual[i] = T(0.0);
+      for (int j = 0; j < 13; ++j)
+      {
+        residual[i] += T(sqrt_gram_(i, j)) * z[j];
+      }
+    }
+    return true;
+  }
+
+private:
+  GramMatrix sqrt_gram_;
+};
+}  // namespace eris::hand_eye_calibration
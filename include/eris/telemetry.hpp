@@ -0,0 +1,65 @@
+// Copyright 2020 Norwegian University of Science and Technology.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <ceres/ceres.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace eris::hand_eye_calibration
+{
+// Fixed-size record of one minimizer iteration.
+struct IterationRecord
+{
+  std::int32_t iteration;
+  std::int32_t linear_solver_iterations;
+  double cost;
+  double cost_change;
+  double gradient_max_norm;
+  double step_norm;
+  double trust_region_radius;
+  double iteration_time_in_seconds;
+  double step_solver_time_in_seconds;
+  double cumulative_time_in_seconds;
+};
+
+auto ToIterationRecord(const ceres::IterationSummary& summary) -> IterationRecord;
+
+// Records every iteration into a buffer allocated before the solve. Records
+// are published through an atomic count, so another thread can copy the
+// iterations done so far while the solve is running. Only Reset and Records,
+// which may reallocate and read the buffer, take the lock.
+class Telemetry : public ceres::IterationCallback
+{
+public:
+  // Clears the records and makes room for capacity iterations. Iterations
+  // beyond the capacity are not recorded.
+  auto Reset(std::size_t capacity) -> void;
+
+  auto operator()(const ceres::IterationSummary& summary) -> ceres::CallbackReturnType override;
+
+  // Copies the records published so far.
+  auto Records() const -> std::vector<IterationRecord>;
+
+private:
+  mutable std::mutex mutex_;
+  std::vector<IterationRecord> records_;
+  std::atomic<std::size_t> size_{ 0 };
+};
+}  // namespace eris::hand_eye_calibration
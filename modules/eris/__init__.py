@@ -14,4 +14,4 @@
 
 import _eris
 from .problem import Problem
-from .solver import Solver
\ No newline at end of file
+from .solver import Solver, IncrementalSolver, calibrate_batch
\ No newline at end of file
@@ -17,61 +17,236 @@ import numpy as np
 import _eris
 
 from eris.problem import Problem
-from eris.transformations import (
-    quaternion_from_matrix,
-    quaternion_matrix,
-    inverse_matrix,
-    random_quaternion,
-    random_vector,
-)
+from eris.transformations import quaternion_matrix, inverse_matrix
 
 
 class Solver:
-    def __init__(self):
-        pass
+    def __init__(self, analytic_jacobian=False, sufficient_statistics=False, num_starts=1, seed=0, loss="trivial", loss_scale=1.0,
+                 outliers=None, outlier_threshold=0.01, outlier_samples=500, options=None, full_report=False):
+        """
+        If analytic_jacobian is set, each pose pair is evaluated as a single block with a hand-derived Jacobian
+        instead of one automatically differentiated block per corner.
+
+        If sufficient_statistics is set, all residuals are first compressed into a 13x13 quadratic form, which makes
+        every solver iteration independent of the number of poses and corners.
+
+        If num_starts is larger than one, that many refinements run concurrently: one from the initial estimate and
+        the rest from random rotations drawn with the given seed. The solution with the lowest cost is returned.
 
-    def _solve(self, problem: Problem, x=None):
+        loss selects a robust loss ('trivial', 'huber', 'cauchy' or 'tukey') with the given scale, which requires the
+        full solve. The scale is a corner residual: the loss applies to each corner without analytic_jacobian, and to
+        the RMS corner residual of each pose pair, weighted by its number of corners, with it. If outliers is 'ransac'
+        or 'lmeds', outlier poses are detected from samples of pose pairs and dropped before the refinement. A pair is an
+        inlier if its RMS corner residual is below outlier_threshold, which LMedS estimates from the data instead.
+
+        options is a dict of Ceres settings: linear_solver_type ('dense_qr', 'dense_normal_cholesky', ...),
+        num_threads, max_num_iterations, function_tolerance, gradient_tolerance, parameter_tolerance,
+        max_solver_time_in_seconds and telemetry. The linear solver and the number of threads are chosen from the
+        problem size unless given. The summary holds the Ceres full report only if full_report is set.
         """
-        Solve the given problem (starting from a 'random' initial guess if the optional argument is not provided).
+        self._analytic_jacobian = analytic_jacobian
+        self._sufficient_statistics = sufficient_statistics
+        self._num_starts = num_starts
+        self._seed = seed
+        self._loss = _eris.LossType.__members__[loss.upper()]
+        self._loss_scale = loss_scale
+        self._outlier_options = self._make_outlier_options(outliers, outlier_threshold, outlier_samples, seed)
+        self._solver_options = self._make_solver_options(options)
+        self._full_report = full_report
+        self._solver = None
+
+    def telemetry(self):
         """
-        if x is not None:
-            q0, t0 = x
-        else:
-            q0 = np.roll(random_quaternion(), 1)
-            t0 = random_vector(3)
+        Cost and timings of each iteration of the current or last calibration as a NumPy structured array, or None
+        before the first one. May be called from another thread while a calibration is running.
+        """
+        solver = self._solver
+        return solver.telemetry() if solver is not None else None
 
+    @staticmethod
+    def _pair_options(pairs, **kwargs):
+        """
+        Build the pose pair selection options from a strategy name ('all', 'consecutive', 'k_nearest', 'random' or
+        'reference') and the strategy parameters (k, rotation_weight, num_pairs, seed, reference).
+        """
+        options = _eris.PairOptions()
+        options.strategy = _eris.PairStrategy.__members__[pairs.upper()]
+        for name, value in kwargs.items():
+            if not hasattr(options, name):
+                raise TypeError("unknown pair option '{}'".format(name))
+            setattr(options, name, value)
+        return options
+
+    @staticmethod
+    def _make_outlier_options(outliers, threshold, num_samples, seed):
+        options = _eris.OutlierOptions()
+        options.method = _eris.OutlierRejection.__members__[(outliers or "none").upper()]
+        options.threshold = threshold
+        options.num_samples = num_samples
+        options.seed = seed
+        return options
+
+    @staticmethod
+    def _make_solver_options(options=None):
+        solver_options = _eris.SolverOptions()
+        for name, value in (options or {}).items():
+            if not hasattr(solver_options, name):
+                raise TypeError("unknown solver option '{}'".format(name))
+            if name == "linear_solver_type" and isinstance(value, str):
+                value = _eris.LinearSolverType.__members__[value.upper()]
+            setattr(solver_options, name, value)
+        return solver_options
+
+    def _solve(self, problem: Problem, x=None, pairs="all", **pair_options):
+        """
+        Solve the given problem (starting from a closed-form estimate if the optional argument is not provided).
+        """
         campoints = problem.campoints
         robposes = problem.robposes
 
-        solver = _eris.Solver(q0, t0)
+        solver = _eris.Solver(*x) if x is not None else _eris.Solver()
+        # Kept so that telemetry() can follow this calibration from another thread.
+        self._solver = solver
+        if self._analytic_jacobian:
+            solver.set_cost_function_type(_eris.CostFunctionType.ANALYTIC)
+        solver.set_pair_options(self._pair_options(pairs, **pair_options))
+        solver.set_loss_function(self._loss, self._loss_scale)
+        solver.set_outlier_options(self._outlier_options)
+        solver.set_options(self._solver_options)
+        solver.add_observations(np.asarray(robposes), np.asarray(campoints))
+
+        method = _eris.SolveMethod.SUFFICIENT_STATISTICS if self._sufficient_statistics else _eris.SolveMethod.FULL
+        if self._num_starts > 1:
+            qopt, topt = solver.solve_multi_start(self._num_starts, method, self._seed)
+        else:
+            qopt, topt = solver.solve(method)
+        Xopt = quaternion_matrix(np.roll(qopt, -1))
+        Xopt[:3, 3] = topt
+
+        summary = _eris.summary_to_dict(solver.summary(), self._full_report)
+        summary["num_pose_pairs"] = solver.num_pairs()
+        summary["estimated_memory_in_bytes"] = solver.estimated_memory_in_bytes()
+        if self._num_starts > 1:
+            multi_start = solver.multi_start_summary()
+            summary["multi_start"] = {
+                "best": multi_start.best,
+                "final_cost": multi_start.final_cost,
+                "rotation_spread": multi_start.rotation_spread,
+                "translation_spread": multi_start.translation_spread,
+            }
+        if self._outlier_options.method != _eris.OutlierRejection.NONE:
+            outliers = solver.outlier_summary()
+            summary["pose_inliers"] = outliers.pose_inliers
+            summary["pair_inliers"] = outliers.pair_inliers
+            summary["pose_residual_median"] = outliers.pose_residual_median
+            summary["pose_residual_max"] = outliers.pose_residual_max
+            summary["outlier_threshold"] = outliers.threshold
+
+        return Xopt, summary
 
-        n = len(robposes)
-        for i in range(n):
-            for j in range(i + 1, n):
-                Ti = robposes[i]
-                qi = np.roll(quaternion_from_matrix(Ti), 1)
-                ti = Ti[:3, 3]
-                pis = campoints[i]
+    def calibrate_eye_in_hand(self, problem, x=None, pairs="all", **pair_options):
+        return self._solve(problem, x, pairs, **pair_options)
 
-                Tj = robposes[j]
-                qj = np.roll(quaternion_from_matrix(Tj), 1)
-                tj = Tj[:3, 3]
-                pjs = campoints[j]
+    def calibrate_eye_to_hand(self, problem, x=None, pairs="all", **pair_options):
+        problem.robposes = [inverse_matrix(robpose) for robpose in problem.robposes]
+        return self._solve(problem, x, pairs, **pair_options)
+
+
+class IncrementalSolver:
+    """
+    Calibration from robot poses that arrive one at a time. Each new pose only adds its own pose pairs to the
+    problem, and every solve starts from the previous estimate.
+    """
+
+    def __init__(self, eye_to_hand=False, x=None, max_poses=None, pairs="all", analytic_jacobian=False,
+                 sufficient_statistics=False, options=None, **pair_options):
+        self._eye_to_hand = eye_to_hand
+        self._sufficient_statistics = sufficient_statistics
+        self._solver = _eris.Solver(*x) if x is not None else _eris.Solver()
+        if analytic_jacobian:
+            self._solver.set_cost_function_type(_eris.CostFunctionType.ANALYTIC)
+        if max_poses is not None:
+            self._solver.set_max_poses(max_poses)
+        self._solver.set_pair_options(Solver._pair_options(pairs, **pair_options))
+        self._solver.set_options(Solver._make_solver_options(options))
+
+    @property
+    def num_poses(self):
+        return self._solver.num_poses()
+
+    def telemetry(self):
+        """
+        Cost and timings of each iteration of the current or last solve as a NumPy structured array. May be called
+        from another thread while a solve is running.
+        """
+        return self._solver.telemetry()
 
-                for pi, pj in zip(pis, pjs):
-                    solver.add_residual_block(qi, ti, pi, qj, tj, pj)
+    def add_pose(self, robpose, campoints):
+        if self._eye_to_hand:
+            robpose = inverse_matrix(robpose)
+        self._solver.add_pose(robpose, np.asarray(campoints))
 
-        qopt, topt = solver.solve()
+    def solve(self):
+        if self._sufficient_statistics:
+            qopt, topt = self._solver.solve(_eris.SolveMethod.SUFFICIENT_STATISTICS)
+        else:
+            qopt, topt = self._solver.solve()
         Xopt = quaternion_matrix(np.roll(qopt, -1))
         Xopt[:3, 3] = topt
 
-        summary = _eris.summary_to_dict(solver.summary())
+        summary = _eris.summary_to_dict(self._solver.summary())
+        summary["num_pose_pairs"] = self._solver.num_pairs()
+        summary["estimated_memory_in_bytes"] = self._solver.estimated_memory_in_bytes()
 
         return Xopt, summary
 
-    def calibrate_eye_in_hand(self, problem, x=None):
-        return self._solve(problem, x)
 
-    def calibrate_eye_to_hand(self, problem, x=None):
-        problem.robposes = [inverse_matrix(robpose) for robpose in problem.robposes]
-        return self._solve(problem, x)
\ No newline at end of file
+def calibrate_batch(problems, threads=0, eye_to_hand=False, pairs="all", analytic_jacobian=False, sufficient_statistics=False,
+                    loss="trivial", loss_scale=1.0, outliers=None, outlier_threshold=0.01, outlier_samples=500,
+                    outlier_seed=0, options=None, **pair_options):
+    """
+    Solve many independent problems concurrently in C++, each starting from the closed-form estimate. threads <= 0
+    uses every core. The options are those of Solver, with the seed of the outlier rejection passed as outlier_seed so
+    that seed, like the other pair_options, selects the pose pairs.
+
+    Returns the stacked (N, 4, 4) solutions and a dict of per-problem statistics. Problems that could not be solved
+    have NaN solutions and are not marked as converged.
+    """
+    observations = []
+    for problem in problems:
+        robposes = np.asarray(problem.robposes, dtype=np.float64)
+        if eye_to_hand:
+            robposes = np.linalg.inv(robposes)
+        observations.append((robposes, np.asarray(problem.campoints, dtype=np.float64)))
+
+    method = _eris.SolveMethod.SUFFICIENT_STATISTICS if sufficient_statistics else _eris.SolveMethod.FULL
+    cost_function_type = _eris.CostFunctionType.ANALYTIC if analytic_jacobian else _eris.CostFunctionType.AUTODIFF
+    result = _eris.calibrate_batch(observations, threads, method, cost_function_type, Solver._pair_options(pairs, **pair_options),
+                                   _eris.LossType.__members__[loss.upper()], loss_scale,
+                                   Solver._make_outlier_options(outliers, outlier_threshold, outlier_samples, outlier_seed),
+                                   Solver._make_solver_options(options))
+
+    # Rotation matrices of the (w, x, y, z) quaternions, for all problems at once.
+    w, x, y, z = result.q.T
+    Xopt = np.zeros((len(observations), 4, 4))
+    Xopt[:, 0, 0] = 1.0 - 2.0 * (y * y + z * z)
+    Xopt[:, 0, 1] = 2.0 * (x * y - w * z)
+    Xopt[:, 0, 2] = 2.0 * (x * z + w * y)
+    Xopt[:, 1, 0] = 2.0 * (x * y + w * z)
+    Xopt[:, 1, 1] = 1.0 - 2.0 * (x * x + z * z)
+    Xopt[:, 1, 2] = 2.0 * (y * z - w * x)
+    Xopt[:, 2, 0] = 2.0 * (x * z - w * y)
+    Xopt[:, 2, 1] = 2.0 * (y * z + w * x)
+    Xopt[:, 2, 2] = 1.0 - 2.0 * (x * x + y * y)
+    Xopt[:, :3, 3] = result.t
+    Xopt[:, 3, 3] = 1.0
+
+    statistics = {
+        "initial_cost": result.initial_cost,
+        "final_cost": result.final_cost,
+        "num_iterations": result.num_iterations,
+        "num_pose_pairs": result.num_pairs,
+        "time_in_seconds": result.time_in_seconds,
+        "converged": result.converged,
+    }
+    return Xopt, statistics
@@ -0,0 +1,90 @@
+// Copyright 2020 Norwegian University of Science and Technology.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <eris/batch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <limits>
+#include <memory>
+
+#include <eris/parallel.hpp>
+
+namespace eris::hand_eye_calibration
+{
+auto CalibrateBatch(const std::vector<BatchProblem>& problems, const BatchOptions& options) -> BatchResult
+{
+  const int n = static_cast<int>(problems.size());
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+
+  BatchResult result;
+  result.q.setConstant(n, 4, nan);
+  result.t.setConstant(n, 3, nan);
+  result.initial_cost.setConstant(n, nan);
+  result.final_cost.setConstant(n, nan);
+  result.num_iterations.setZero(n);
+  result.num_pairs.setZero(n);
+  result.time_in_seconds.setZero(n);
+  result.converged.setConstant(n, false);
+
+  int num_threads = options.num_threads;
+  if (num_threads <= 0)
+  {
+    num_threads = DefaultNumThreads();
+  }
+
+  // Configured up front, so that invalid options throw on the calling thread
+  // rather than inside a worker.
+  std::vector<std::unique_ptr<Solver>> solvers(std::max(std::min(num_threads, n), 1));
+  for (std::unique_ptr<Solver>& solver : solvers)
+  {
+    solver = std::make_unique<Solver>();
+    solver->SetCostFunctionType(options.cost_function_type);
+    solver->SetPairOptions(options.pair_options);
+    solver->SetLossFunction(options.loss_type, options.loss_scale);
+    solver->SetOutlierOptions(options.outlier_options);
+    solver->SetOptions(options.solver_options);
+    solver->SetNumThreads(1);
+  }
+
+  // Each thread reuses its solver for every problem it picks up.
+  ParallelFor(0, n, static_cast<int>(solvers.size()), [&](int thread_id, int index) {
+    const auto start = std::chrono::steady_clock::now();
+
+    const std::unique_ptr<Solver>& solver = solvers[thread_id];
+    solver->Reset();
+
+    // A bad problem only fails its own row.
+    try
+    {
+      solver->AddObservations(problems[index].robposes, problems[index].campoints);
+      const auto [q, t] = solver->Solve(options.method);
+      const ceres::Solver::Summary summary = solver->Summary();
+      result.q.row(index) = q.transpose();
+      result.t.row(index) = t.transpose();
+      result.initial_cost(index) = summary.initial_cost;
+      result.final_cost(index) = summary.final_cost;
+      result.num_iterations(index) = summary.num_successful_steps + summary.num_unsuccessful_steps;
+      result.converged(index) = summary.termination_type == ceres::CONVERGENCE;
+    }
+    catch (const std::exception&)
+    {
+    }
+    result.num_pairs(index) = solver->NumPairs();
+    result.time_in_seconds(index) = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  });
+  return result;
+}
+}  // namespace eris::hand_eye_calibration
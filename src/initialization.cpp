@@ -0,0 +1,110 @@
+// Copyright 2020 Norwegian University of Science and Technology.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <eris/initialization.hpp>
+
+#include <Eigen/Geometry>
+#include <Eigen/SVD>
+
+#include <algorithm>
+#include <numeric>
+
+#include <eris/parallel.hpp>
+
+namespace eris::hand_eye_calibration
+{
+namespace
+{
+// Smallest rotation angle, in radians, of a motion used for the rotation estimate.
+constexpr double kMinRotationAngle = 1e-3;
+}  // namespace
+
+auto PairMotion(const Pose& pose_i, const Pose& pose_j) -> Motion
+{
+  Motion motion;
+  const Eigen::Index m = std::min(pose_i.points.rows(), pose_j.points.rows());
+  if (m < 3)
+  {
+    return motion;
+  }
+
+  motion.RA = pose_i.R.transpose() * pose_j.R;
+  motion.tA = pose_i.R.transpose() * (pose_j.t - pose_i.t);
+
+  const Eigen::Matrix4d B = Eigen::umeyama(pose_j.points.topRows(m).transpose(), pose_i.points.topRows(m).transpose(), false);
+  motion.RB = B.topLeftCorner<3, 3>();
+  motion.tB = B.topRightCorner<3, 1>();
+
+  const Eigen::AngleAxisd alpha(motion.RA);
+  const Eigen::AngleAxisd beta(motion.RB);
+  motion.alpha = alpha.angle() * alpha.axis();
+  motion.beta = beta.angle() * beta.axis();
+  motion.valid = true;
+  return motion;
+}
+
+auto ParkMartin(const std::vector<Motion>& motions, const std::vector<int>& indices, Eigen::Vector4d* q, Eigen::Vector3d* t) -> bool
+{
+  Eigen::Matrix3d correlation = Eigen::Matrix3d::Zero();
+  for (const int index : indices)
+  {
+    const Motion& motion = motions[index];
+    if (motion.valid && motion.alpha.norm() >= kMinRotationAngle && motion.beta.norm() >= kMinRotationAngle)
+    {
+      correlation.noalias() += motion.beta * motion.alpha.transpose();
+    }
+  }
+
+  // R_X = argmin sum |alpha - R_X beta|^2.
+  const Eigen::JacobiSVD<Eigen::Matrix3d> svd(correlation, Eigen::ComputeFullU | Eigen::ComputeFullV);
+  if (!(svd.singularValues()(1) > 1e-9 * svd.singularValues()(0)))
+  {
+    return false;
+  }
+  Eigen::Matrix3d D = Eigen::Matrix3d::Identity();
+  D(2, 2) = (svd.matrixV() * svd.matrixU().transpose()).determinant() < 0.0 ? -1.0 : 1.0;
+  const Eigen::Matrix3d RX = svd.matrixV() * D * svd.matrixU().transpose();
+
+  // (R_A - I) t_X = R_X t_B - t_A, solved through the normal equations.
+  Eigen::Matrix3d normal = Eigen::Matrix3d::Zero();
+  Eigen::Vector3d rhs = Eigen::Vector3d::Zero();
+  for (const int index : indices)
+  {
+    const Motion& motion = motions[index];
+    if (motion.valid)
+    {
+      const Eigen::Matrix3d C = motion.RA - Eigen::Matrix3d::Identity();
+      normal.noalias() += C.transpose() * C;
+      rhs.noalias() += C.transpose() * (RX * motion.tB - motion.tA);
+    }
+  }
+
+  const Eigen::Quaterniond qx(RX);
+  *q << qx.w(), qx.x(), qx.y(), qx.z();
+  *t = normal.ldlt().solve(rhs);
+  return true;
+}
+
+auto ParkMartin(const std::vector<Pose>& poses, const std::vector<PosePair>& pairs, int num_threads, Eigen::Vector4d* q, Eigen::Vector3d* t)
+    -> bool
+{
+  std::vector<Motion> motions(pairs.size());
+  ParallelFor(0, static_cast<int>(pairs.size()), num_threads,
+              [&](int, int index) { motions[index] = PairMotion(poses[pairs[index].first], poses[pairs[index].second]); });
+
+  std::vector<int> indices(pairs.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  return ParkMartin(motions, indices, q, t);
+}
+}  // namespace eris::hand_eye_calibration
@@ -0,0 +1,210 @@
+// Copyright 2020 Norwegian University of Science and Technology.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <eris/outliers.hpp>
+
+#include <Eigen/Geometry>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include <eris/initialization.hpp>
+#include <eris/parallel.hpp>
+#include <eris/sufficient_statistics.hpp>
+
+namespace eris::hand_eye_calibration
+{
+namespace
+{
+auto DesignVector(const Eigen::Vector4d& q, const Eigen::Vector3d& t) -> Eigen::Matrix<double, 13, 1>
+{
+  const Eigen::Matrix3d R = Eigen::Quaterniond(q(0), q(1), q(2), q(3)).normalized().toRotationMatrix();
+  Eigen::Matrix<double, 13, 1> z;
+  z << Eigen::Map<const Eigen::Matrix<double, 9, 1>>(R.data()), t, 1.0;
+  return z;
+}
+
+// Squared RMS corner residuals of the scored pairs under (q, t).
+auto SquaredResiduals(const std::vector<GramMatrix>& grams, const std::vector<double>& num_points, const Eigen::Vector4d& q,
+                      const Eigen::Vector3d& t, std::vector<double>* residuals) -> void
+{
+  const Eigen::Matrix<double, 13, 1> z = DesignVector(q, t);
+  residuals->resize(grams.size());
+  for (std::size_t k = 0; k < grams.size(); ++k)
+  {
+    (*residuals)[k] = std::max(z.dot(grams[k] * z), 0.0) / num_points[k];
+  }
+}
+
+auto Median(std::vector<double> values) -> double
+{
+  const auto middle = values.begin() + values.size() / 2;
+  std::nth_element(values.begin(), middle, values.end());
+  return *middle;
+}
+}  // namespace
+
+auto RejectOutliers(const std::vector<Pose>& poses, const std::vector<PosePair>& pairs, const OutlierOptions& options, int num_threads,
+                    OutlierSummary* summary) -> bool
+{
+  // Pairs with a dropped pose take no part.
+  std::vector<int> scored;
+  for (std::size_t index = 0; index < pairs.size(); ++index)
+  {
+    if (poses[pairs[index].first].points.rows() > 0 && poses[pairs[index].second].points.rows() > 0)
+    {
+      scored.push_back(static_cast<int>(index));
+    }
+  }
+  const int n = static_cast<int>(scored.size());
+  if (n < 2 || options.num_samples < 1)
+  {
+    return false;
+  }
+
+  std::vector<Motion> motions(n);
+  std::vector<GramMatrix> grams(n);
+  std::vector<double> num_points(n);
+  ParallelFor(0, n, num_threads, [&](int, int k) {
+    const auto [i, j] = pairs[scored[k]];
+    motions[k] = PairMotion(poses[i], poses[j]);
+    grams[k] = AccumulateGram(poses, pairs, scored[k], scored[k] + 1, 1);
+    num_points[k] = static_cast<double>(std::min(poses[i].points.rows(), poses[j].points.rows()));
+  });
+
+  // Every sample draws from its own generator, so the result does not depend
+  // on the number of threads.
+  std::vector<double> costs(options.num_samples, std::numeric_limits<double>::infinity());
+  std::vector<Eigen::Vector4d> qs(options.num_samples);
+  std::vector<Eigen::Vector3d> ts(options.num_samples);
+  const double threshold2 = options.threshold * options.threshold;
+  ParallelFor(0, options.num_samples, num_threads, [&](int, int s) {
+    std::seed_seq seed{ options.seed, static_cast<std::uint32_t>(s) };
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> first(0, n - 1);
+    std::uniform_int_distribution<int> second(0, n - 2);
+    std::vector<int> sample(2);
+    sample[0] = first(generator);
+    sample[1] = second(generator);
+    sample[1] += sample[1] >= sample[0] ? 1 : 0;
+    if (!ParkMartin(motions, sample, &qs[s], &ts[s]))
+    {
+      return;
+    }
+
+    std::vector<double> residuals;
+    SquaredResiduals(grams, num_points, qs[s], ts[s], &residuals);
+    if (options.method == OutlierRejection::LMEDS)
+    {
+      costs[s] = Median(std::move(residuals));
+      return;
+    }
+    costs[s] = 0.0;
+    for (const double r2 : residuals)
+    {
+      costs[s] += std::min(r2, threshold2);
+    }
+  });
+
+  const int best = static_cast<int>(std::min_element(costs.begin(), costs.end()) - costs.begin());
+  if (!std::isfinite(costs[best]))
+  {
+    return false;
+  }
+
+  double threshold = options.threshold;
+  if (options.method == OutlierRejection::LMEDS)
+  {
+    // Robust standard deviation with the small sample correction of Rousseeuw and Leroy.
+    const double sigma = 1.4826 * (1.0 + 5.0 / std::max(n - 2, 1)) * std::sqrt(costs[best]);
+    threshold = 2.5 * sigma;
+  }
+
+  // Refit to the inliers of the best hypothesis.
+  Eigen::Vector4d q = qs[best];
+  Eigen::Vector3d t = ts[best];
+  std::vector<double> residuals;
+  SquaredResiduals(grams, num_points, q, t, &residuals);
+  std::vector<int> inliers;
+  for (int k = 0; k < n; ++k)
+  {
+    if (residuals[k] <= threshold * threshold)
+    {
+      inliers.push_back(k);
+    }
+  }
+  if (ParkMartin(motions, inliers, &q, &t))
+  {
+    SquaredResiduals(grams, num_points, q, t, &residuals);
+  }
+  else
+  {
+    q = qs[best];
+    t = ts[best];
+  }
+
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const Eigen::Index num_poses = static_cast<Eigen::Index>(poses.size());
+  summary->pair_residuals.setConstant(pairs.size(), nan);
+  for (int k = 0; k < n; ++k)
+  {
+    summary->pair_residuals(scored[k]) = std::sqrt(residuals[k]);
+  }
+
+  std::vector<std::vector<double>> pose_residuals(num_poses);
+  Eigen::VectorXi num_inlier_pairs = Eigen::VectorXi::Zero(num_poses);
+  for (const int index : scored)
+  {
+    const auto [i, j] = pairs[index];
+    const double r = summary->pair_residuals(index);
+    pose_residuals[i].push_back(r);
+    pose_residuals[j].push_back(r);
+    if (r <= threshold)
+    {
+      ++num_inlier_pairs(i);
+      ++num_inlier_pairs(j);
+    }
+  }
+
+  summary->pose_inliers.setConstant(num_poses, false);
+  summary->pose_residual_median.setConstant(num_poses, nan);
+  summary->pose_residual_max.setConstant(num_poses, nan);
+  for (Eigen::Index i = 0; i < num_poses; ++i)
+  {
+    // Without scored pairs there is no evidence against a pose.
+    if (pose_residuals[i].empty())
+    {
+      summary->pose_inliers(i) = poses[i].points.rows() > 0;
+      continue;
+    }
+    summary->pose_inliers(i) = num_inlier_pairs(i) >= options.min_inlier_ratio * pose_residuals[i].size();
+    summary->pose_residual_max(i) = *std::max_element(pose_residuals[i].begin(), pose_residuals[i].end());
+    summary->pose_residual_median(i) = Median(std::move(pose_residuals[i]));
+  }
+
+  summary->pair_inliers.setConstant(pairs.size(), false);
+  for (const int index : scored)
+  {
+    const auto [i, j] = pairs[index];
+    summary->pair_inliers(index) = summary->pose_inliers(i) && summary->pose_inliers(j) && summary->pair_residuals(index) <= threshold;
+  }
+
+  summary->threshold = threshold;
+  summary->q = q;
+  summary->t = t;
+  return true;
+}
+}  // namespace eris::hand_eye_calibration
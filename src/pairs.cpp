@@ -0,0 +1,249 @@
+// Copyright 2020 Norwegian University of Science and Technology.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <eris/pairs.hpp>
+
+#include <Eigen/Geometry>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace eris::hand_eye_calibration
+{
+namespace
+{
+auto PoseDistance(const Pose& a, const Pose& b, double rotation_weight) -> double
+{
+  const double angle = Eigen::AngleAxisd(a.R.transpose() * b.R).angle();
+  return (a.t - b.t).norm() + rotation_weight * angle;
+}
+
+// Maps a linear index in [0, n (n - 1) / 2) to the pair (i, j), i < j, in the
+// order produced by two nested loops.
+auto PairFromIndex(std::int64_t index, std::int64_t n) -> PosePair
+{
+  std::int64_t i = 0;
+  std::int64_t row_length = n - 1;
+  while (index >= row_length)
+  {
+    index -= row_length;
+    --row_length;
+    ++i;
+  }
+  return PosePair(static_cast<int>(i), static_cast<int>(i + 1 + index));
+}
+
+auto AllPairs(int begin, int end) -> std::vector<PosePair>
+{
+  std::vector<PosePair> pairs;
+  const std::int64_t n = end - begin;
+  pairs.reserve(n * (n - 1) / 2);
+  for (int i = begin; i < end; ++i)
+  {
+    for (int j = i + 1; j < end; ++j)
+    {
+      pairs.emplace_back(i, j);
+    }
+  }
+  return pairs;
+}
+
+auto ConsecutivePairs(int begin, int end) -> std::vector<PosePair>
+{
+  std::vector<PosePair> pairs;
+  for (int i = begin; i + 1 < end; ++i)
+  {
+    pairs.emplace_back(i, i + 1);
+  }
+  return pairs;
+}
+
+auto NearestPairs(const std::vector<Pose>& poses, int begin, int end, int k, double rotation_weight) -> std::vector<PosePair>
+{
+  std::vector<PosePair> pairs;
+  std::vector<std::pair<double, int>> neighbours;
+  for (int i = begin; i < end; ++i)
+  {
+    neighbours.clear();
+    for (int j = begin; j < end; ++j)
+    {
+      if (j != i)
+      {
+        neighbours.emplace_back(PoseDistance(poses[i], poses[j], rotation_weight), j);
+      }
+    }
+    const int num_neighbours = std::min<int>(k, static_cast<int>(neighbours.size()));
+    std::partial_sort(neighbours.begin(), neighbours.begin() + num_neighbours, neighbours.end());
+    for (int n = 0; n < num_neighbours; ++n)
+    {
+      const int j = neighbours[n].second;
+      pairs.emplace_back(std::min(i, j), std::max(i, j));
+    }
+  }
+  std::sort(pairs.begin(), pairs.end());
+  pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+  return pairs;
+}
+
+// Floyd's algorithm: draws num_pairs distinct pairs without enumerating all of them.
+auto RandomPairs(int begin, int end, int num_pairs, std::uint32_t seed) -> std::vector<PosePair>
+{
+  const std::int64_t n = end - begin;
+  const std::int64_t total = n * (n - 1) / 2;
+  if (num_pairs >= total)
+  {
+    return AllPairs(begin, end);
+  }
+
+  std::mt19937_64 generator(seed);
+  std::unordered_set<std::int64_t> selected;
+  selected.reserve(num_pairs);
+  for (std::int64_t r = total - num_pairs; r < total; ++r)
+  {
+    const std::int64_t index = std::uniform_int_distribution<std::int64_t>(0, r)(generator);
+    if (!selected.insert(index).second)
+    {
+      selected.insert(r);
+    }
+  }
+
+  std::vector<std::int64_t> indices(selected.begin(), selected.end());
+  std::sort(indices.begin(), indices.end());
+  std::vector<PosePair> pairs;
+  pairs.reserve(indices.size());
+  for (const std::int64_t index : indices)
+  {
+    const auto [i, j] = PairFromIndex(index, n);
+    pairs.emplace_back(begin + i, begin + j);
+  }
+  return pairs;
+}
+
+auto ReferencePairs(int begin, int end, int reference) -> std::vector<PosePair>
+{
+  const int r = begin + reference;
+  if (r < begin || r >= end)
+  {
+    throw std::out_of_range("reference pose index out of range");
+  }
+  std::vector<PosePair> pairs;
+  for (int i = begin; i < end; ++i)
+  {
+    if (i != r)
+    {
+      pairs.emplace_back(std::min(i, r), std::max(i, r));
+    }
+  }
+  return pairs;
+}
+}  // namespace
+
+auto SelectPairs(const std::vector<Pose>& poses, int begin, int end, const PairOptions& options) -> std::vector<PosePair>
+{
+  switch (options.strategy)
+  {
+    case PairStrategy::ALL:
+      return AllPairs(begin, end);
+    case PairStrategy::CONSECUTIVE:
+      return ConsecutivePairs(begin, end);
+    case PairStrategy::K_NEAREST:
+      return NearestPairs(poses, begin, end, options.k, options.rotation_weight);
+    case PairStrategy::RANDOM:
+      return RandomPairs(begin, end, options.num_pairs, options.seed);
+    case PairStrategy::REFERENCE:
+      return ReferencePairs(begin, end, options.reference);
+  }
+  throw std::invalid_argument("unknown pair strategy");
+}
+
+auto SelectPairsForNewPose(const std::vector<Pose>& poses, int begin, int index, const PairOptions& options) -> std::vector<PosePair>
+{
+  if (options.strategy == PairStrategy::REFERENCE && options.reference < 0)
+  {
+    throw std::out_of_range("reference pose index out of range");
+  }
+
+  std::vector<PosePair> pairs;
+  if (index <= begin)
+  {
+    return pairs;
+  }
+
+  // Poses dropped from the window, such as rejected outliers, have no points
+  // and are never partners.
+  std::vector<int> candidates;
+  for (int i = begin; i < index; ++i)
+  {
+    if (poses[i].points.rows() > 0)
+    {
+      candidates.push_back(i);
+    }
+  }
+  if (candidates.empty())
+  {
+    return pairs;
+  }
+
+  switch (options.strategy)
+  {
+    case PairStrategy::ALL:
+      for (const int i : candidates)
+      {
+        pairs.emplace_back(i, index);
+      }
+      break;
+    case PairStrategy::CONSECUTIVE:
+      pairs.emplace_back(candidates.back(), index);
+      break;
+    case PairStrategy::K_NEAREST:
+    {
+      std::vector<std::pair<double, int>> neighbours;
+      for (const int i : candidates)
+      {
+        neighbours.emplace_back(PoseDistance(poses[i], poses[index], options.rotation_weight), i);
+      }
+      const int num_neighbours = std::min<int>(options.k, static_cast<int>(neighbours.size()));
+      std::partial_sort(neighbours.begin(), neighbours.begin() + num_neighbours, neighbours.end());
+      for (int n = 0; n < num_neighbours; ++n)
+      {
+        pairs.emplace_back(neighbours[n].second, index);
+      }
+      std::sort(pairs.begin(), pairs.end());
+      break;
+    }
+    case PairStrategy::RANDOM:
+    {
+      const int num_partners = std::min<int>(options.k, static_cast<int>(candidates.size()));
+      std::mt19937_64 generator(options.seed + static_cast<std::uint64_t>(index));
+      for (int n = 0; n < num_partners; ++n)
+      {
+        std::swap(candidates[n], candidates[std::uniform_int_distribution<int>(n, static_cast<int>(candidates.size()) - 1)(generator)]);
+        pairs.emplace_back(candidates[n], index);
+      }
+      std::sort(pairs.begin(), pairs.end());
+      break;
+    }
+    case PairStrategy::REFERENCE:
+      if (begin + options.reference < index && poses[begin + options.reference].points.rows() > 0)
+      {
+        pairs.emplace_back(begin + options.reference, index);
+      }
+      break;
+  }
+  return pairs;
+}
+}  // namespace eris::hand_eye_calibration
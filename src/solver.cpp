@@ -14,38 +14,962 @@
 
 #include <eris/solver.hpp>
 
+#include <Eigen/Geometry>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+#include <eris/parallel.hpp>
+
 namespace eris::hand_eye_calibration
 {
+namespace
+{
+auto Skew(const Eigen::Vector3d& v) -> Eigen::Matrix3d
+{
+  Eigen::Matrix3d S;
+  S << 0.0, -v(2), v(1), v(2), 0.0, -v(0), -v(1), v(0), 0.0;
+  return S;
+}
+
+// Rotation matrix of the unit quaternion u = (w, x, y, z), using the same
+// expression as ceres::UnitQuaternionRotatePoint.
+auto UnitQuaternionToRotation(const Eigen::Vector4d& u) -> Eigen::Matrix3d
+{
+  const Eigen::Matrix3d S = Skew(u.tail<3>());
+  return Eigen::Matrix3d::Identity() + 2.0 * u(0) * S + 2.0 * S * S;
+}
+
+// Derivative of UnitQuaternionToRotation(u) * p with respect to u.
+auto UnitQuaternionRotatePointJacobian(const Eigen::Vector4d& u, const Eigen::Vector3d& p) -> Eigen::Matrix<double, 3, 4>
+{
+  const double w = u(0);
+  const Eigen::Vector3d v = u.tail<3>();
+  Eigen::Matrix<double, 3, 4> J;
+  J.col(0) = 2.0 * v.cross(p);
+  J.rightCols<3>() = -2.0 * w * Skew(p) + 2.0 * (v.dot(p) * Eigen::Matrix3d::Identity() + v * p.transpose() - 2.0 * p * v.transpose());
+  return J;
+}
+
+auto MakeLossFunction(LossType type, double scale) -> std::unique_ptr<ceres::LossFunction>
+{
+  switch (type)
+  {
+    case LossType::TRIVIAL:
+      return nullptr;
+    case LossType::HUBER:
+      return std::make_unique<ceres::HuberLoss>(scale);
+    case LossType::CAUCHY:
+      return std::make_unique<ceres::CauchyLoss>(scale);
+    case LossType::TUKEY:
+      return std::make_unique<ceres::TukeyLoss>(scale);
+  }
+  throw std::invalid_argument("unknown loss type");
+}
+}  // namespace
+
+PairCostFunction::PairCostFunction(const Eigen::Matrix3d& Ri, const Eigen::Vector3d& ti, const Points& pi, const Eigen::Matrix3d& Rj,
+                                   const Eigen::Vector3d& tj, const Points& pj)
+  : Ri_(Ri), ti_(ti), pi_(pi), Rj_(Rj), tj_(tj), pj_(pj)
+{
+  set_num_residuals(3 * static_cast<int>(pi_.rows()));
+  mutable_parameter_block_sizes()->push_back(4);
+  mutable_parameter_block_sizes()->push_back(3);
+}
+
+// The residual of corner k is A pj_k - B pi_k + c with A = Rj Rx, B = Ri Rx and
+// c = (Rj - Ri) tx + tj - ti. Each residual component a is evaluated for all
+// corners at once as a matrix-vector product over the point columns.
+auto PairCostFunction::Evaluate(double const* const* parameters, double* residuals, double** jacobians) const -> bool
+{
+  const Eigen::Map<const Eigen::Vector4d> q(parameters[0]);
+  const Eigen::Map<const Eigen::Vector3d> tx(parameters[1]);
+  const Eigen::Index m = pi_.rows();
+
+  // Like ceres::QuaternionRotatePoint, q is normalized before use.
+  const double norm = q.norm();
+  const Eigen::Vector4d u = q / norm;
+  const Eigen::Matrix3d Rx = UnitQuaternionToRotation(u);
+  const Eigen::Matrix3d A = Rj_ * Rx;
+  const Eigen::Matrix3d B = Ri_ * Rx;
+  const Eigen::Matrix3d D = Rj_ - Ri_;
+  const Eigen::Vector3d c = D * tx + tj_ - ti_;
+
+  for (int a = 0; a < 3; ++a)
+  {
+    Eigen::Map<Eigen::VectorXd, 0, Eigen::InnerStride<3>> r(residuals + a, m);
+    r.noalias() = pj_ * A.row(a).transpose();
+    r.noalias() -= pi_ * B.row(a).transpose();
+    r.array() += c(a);
+  }
+
+  if (jacobians == nullptr)
+  {
+    return true;
+  }
+
+  if (jacobians[0] != nullptr)
+  {
+    // d(Rx p)/dq = sum_n p_n G_n, where G_n is the derivative of column n of Rx
+    // including the normalization of q. Row n of Kj[a] is row a of Rj G_n.
+    const Eigen::Matrix4d P = (Eigen::Matrix4d::Identity() - u * u.transpose()) / norm;
+    Eigen::Matrix<double, 3, 4> Kj[3];
+    Eigen::Matrix<double, 3, 4> Ki[3];
+    for (int n = 0; n < 3; ++n)
+    {
+      const Eigen::Matrix<double, 3, 4> G = UnitQuaternionRotatePointJacobian(u, Eigen::Vector3d::Unit(n)) * P;
+      const Eigen::Matrix<double, 3, 4> Hj = Rj_ * G;
+      const Eigen::Matrix<double, 3, 4> Hi = Ri_ * G;
+      for (int a = 0; a < 3; ++a)
+      {
+        Kj[a].row(n) = Hj.row(a);
+        Ki[a].row(n) = Hi.row(a);
+      }
+    }
+    for (int a = 0; a < 3; ++a)
+    {
+      Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, 4, Eigen::RowMajor>, 0, Eigen::OuterStride<>> J(jacobians[0] + 4 * a, m, 4,
+                                                                                                       Eigen::OuterStride<>(12));
+      J.noalias() = pj_ * Kj[a];
+      J.noalias() -= pi_ * Ki[a];
+    }
+  }
+
+  if (jacobians[1] != nullptr)
+  {
+    for (Eigen::Index k = 0; k < m; ++k)
+    {
+      Eigen::Map<Eigen::Matrix<double, 3, 3, Eigen::RowMajor>>(jacobians[1] + 9 * k) = D;
+    }
+  }
+  return true;
+}
+
+auto Solver::ProblemOptions() -> ceres::Problem::Options
+{
+  ceres::Problem::Options options;
+  options.cost_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+  options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+  options.enable_fast_removal = true;
+  return options;
+}
+
 auto Solver::AddResidualBlock(const Eigen::Vector4d& qi, const Eigen::Vector3d& ti, const Eigen::Vector3d& pi, const Eigen::Vector4d& qj,
                               const Eigen::Vector3d& tj, const Eigen::Vector3d& pj) -> bool
 {
-  ceres::CostFunction* cost_function = new ceres::AutoDiffCostFunction<CostFunctor, 3, 4, 3>(new CostFunctor(qi, ti, pi, qj, tj, pj));
-  problem_.AddResidualBlock(cost_function, NULL, q_opt_.data(), t_opt_.data());
+  std::lock_guard<std::mutex> lock(mutex_);
+  const CostFunctor* functor = loose_functors_.Create(qi, ti, pi, qj, tj, pj);
+  problem_->AddResidualBlock(loose_cost_functions_.Create(functor), loss_function_.get(), q_opt_.data(), t_opt_.data());
+
+  const Eigen::Matrix<double, 3, 13> M =
+      CornerDesignMatrix(UnitQuaternionToRotation(qi.normalized()), ti, pi, UnitQuaternionToRotation(qj.normalized()), tj, pj);
+  loose_gram_.noalias() += M.transpose() * M;
+  gram_.noalias() += M.transpose() * M;
+  return true;
+}
+
+auto Solver::Reset() -> void
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  problem_ = std::make_unique<ceres::Problem>(ProblemOptions());
+  functors_.Reset();
+  cost_functions_.Reset();
+  pair_cost_functions_.Reset();
+  loose_functors_.Reset();
+  loose_cost_functions_.Reset();
+
+  poses_.clear();
+  pose_pairs_.clear();
+  pairs_.clear();
+  pair_blocks_.clear();
+  num_points_ = -1;
+  pair_loss_function_.reset();
+  first_pose_ = 0;
+  num_active_pairs_ = 0;
+  num_pairs_in_problem_ = 0;
+  num_pairs_in_gram_ = 0;
+  num_evicted_blocks_ = 0;
+  reference_pose_ = -1;
+  gram_.setZero();
+  loose_gram_.setZero();
+
+  summary_ = ceres::Solver::Summary();
+  multi_start_summary_ = hand_eye_calibration::MultiStartSummary();
+  outlier_summary_ = hand_eye_calibration::OutlierSummary();
+  local_parameterization_is_set_ = false;
+  needs_initialization_ = true;
+  q_opt_ << 1.0, 0.0, 0.0, 0.0;
+  t_opt_.setZero();
+}
+
+auto Solver::AddObservations(const Eigen::Ref<const RowMatrixXd>& robposes, const Eigen::Ref<const RowMatrixXd>& campoints) -> bool
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Checked before the poses are stored, like the explicit pairs below.
+  if (pair_options_.strategy == PairStrategy::REFERENCE && pair_options_.reference >= robposes.rows())
+  {
+    throw std::out_of_range("reference pose index out of range");
+  }
+
+  const int offset = AppendPoses(robposes, campoints);
+  for (const auto& [i, j] : SelectPairs(poses_, offset, static_cast<int>(poses_.size()), pair_options_))
+  {
+    AddPair(i, j);
+  }
+  if (pair_options_.strategy == PairStrategy::REFERENCE)
+  {
+    SetReferencePose(offset + pair_options_.reference);
+  }
+  EvictPoses();
   return true;
 }
 
-auto Solver::Solve() -> std::tuple<Eigen::Vector4d, Eigen::Vector3d>
+auto Solver::AddObservations(const Eigen::Ref<const RowMatrixXd>& robposes, const Eigen::Ref<const RowMatrixXd>& campoints,
+                             const std::vector<PosePair>& pairs) -> bool
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int n = static_cast<int>(robposes.rows());
+  for (const auto& [i, j] : pairs)
+  {
+    if (i < 0 || i >= n || j < 0 || j >= n)
+    {
+      throw std::out_of_range("pose pair index out of range");
+    }
+  }
+
+  const int offset = AppendPoses(robposes, campoints);
+  for (const auto& [i, j] : pairs)
+  {
+    AddPair(offset + i, offset + j);
+  }
+  EvictPoses();
+  return true;
+}
+
+auto Solver::AddPose(const Eigen::Matrix4d& robpose, const Eigen::Ref<const RowMatrixXd>& campoints) -> bool
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (campoints.cols() != 3)
+  {
+    throw std::invalid_argument("campoints must have shape (M, 3)");
+  }
+  const Eigen::Matrix<double, 4, 4, Eigen::RowMajor> T = robpose;
+  const RowMatrixXd points = campoints;
+
+  const int index = AppendPoses(Eigen::Map<const RowMatrixXd>(T.data(), 1, 16), Eigen::Map<const RowMatrixXd>(points.data(), 1, points.size()));
+  if (pair_options_.strategy == PairStrategy::REFERENCE)
+  {
+    AddReferencePairs(index);
+  }
+  else
+  {
+    for (const auto& [i, j] : SelectPairsForNewPose(poses_, first_pose_, index, pair_options_))
+    {
+      AddPair(i, j);
+    }
+  }
+  EvictPoses();
+  return true;
+}
+
+auto Solver::AppendPoses(const Eigen::Ref<const RowMatrixXd>& robposes, const Eigen::Ref<const RowMatrixXd>& campoints) -> int
+{
+  const int n = static_cast<int>(robposes.rows());
+  if (robposes.cols() != 16)
+  {
+    throw std::invalid_argument("robposes must hold one 4x4 pose per row");
+  }
+  if (campoints.rows() != n || campoints.cols() % 3 != 0)
+  {
+    throw std::invalid_argument("campoints must hold one set of 3D points per robot pose");
+  }
+  if (num_points_ >= 0 && campoints.cols() != 3 * num_points_)
+  {
+    throw std::invalid_argument("campoints must have the same number of points for every robot pose");
+  }
+
+  const int offset = static_cast<int>(poses_.size());
+  const int m = static_cast<int>(campoints.cols() / 3);
+  num_points_ = m;
+  poses_.reserve(offset + n);
+  pose_pairs_.resize(offset + n);
+  for (int k = 0; k < n; ++k)
+  {
+    Eigen::Map<const Eigen::Matrix<double, 4, 4, Eigen::RowMajor>> T(robposes.row(k).data());
+    const Eigen::Quaterniond q(Eigen::Matrix3d(T.topLeftCorner<3, 3>()));
+
+    Pose pose;
+    pose.q << q.w(), q.x(), q.y(), q.z();
+    pose.R = UnitQuaternionToRotation(pose.q);
+    pose.t = T.topRightCorner<3, 1>();
+    pose.points = Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor>>(campoints.row(k).data(), m, 3);
+    poses_.push_back(std::move(pose));
+  }
+  return offset;
+}
+
+auto Solver::AddPair(int i, int j) -> void
+{
+  pose_pairs_[i].push_back(static_cast<int>(pairs_.size()));
+  pose_pairs_[j].push_back(static_cast<int>(pairs_.size()));
+  pairs_.emplace_back(i, j);
+  pair_blocks_.emplace_back();
+  if (IsActive(pairs_.back()))
+  {
+    ++num_active_pairs_;
+  }
+}
+
+// Unlike SelectPairsForNewPose, which counts the reference pose from the start
+// of the window, the reference pose is fixed once it arrives, so the pairs of
+// the window keep sharing it as the window moves. The pose at the reference
+// position of the window takes over, paired with every pose in the window, if
+// there is none yet or it was rejected as an outlier.
+auto Solver::AddReferencePairs(int index) -> void
+{
+  if (pair_options_.reference < 0)
+  {
+    throw std::out_of_range("reference pose index out of range");
+  }
+  if (reference_pose_ >= 0)
+  {
+    AddPair(reference_pose_, index);
+    return;
+  }
+
+  const int reference = first_pose_ + pair_options_.reference;
+  if (reference > index)
+  {
+    return;
+  }
+  SetReferencePose(reference);
+  for (int i = first_pose_; i <= index; ++i)
+  {
+    if (i != reference && poses_[i].points.rows() > 0)
+    {
+      AddPair(std::min(i, reference), std::max(i, reference));
+    }
+  }
+}
+
+auto Solver::SetReferencePose(int index) -> void
+{
+  // A previous reference pose the window has moved past is evicted now.
+  if (reference_pose_ >= 0 && reference_pose_ < first_pose_)
+  {
+    DropPose(reference_pose_);
+  }
+  reference_pose_ = index;
+}
+
+auto Solver::IsActive(const PosePair& pair) const -> bool
+{
+  return poses_[pair.first].points.rows() > 0 && poses_[pair.second].points.rows() > 0;
+}
+
+// Takes an active pair out of the problem and the Gram matrix. The pair stays
+// in pairs_ until it is erased or its pose is dropped.
+auto Solver::DropPair(int index) -> void
+{
+  if (static_cast<std::size_t>(index) < num_pairs_in_gram_)
+  {
+    gram_ -= AccumulateGram(poses_, pairs_, index, index + 1, 1);
+  }
+  for (const Block& block : pair_blocks_[index])
+  {
+    problem_->RemoveResidualBlock(block.id);
+  }
+  num_evicted_blocks_ += pair_blocks_[index].size();
+  pair_blocks_[index] = std::vector<Block>();
+  --num_active_pairs_;
+}
+
+auto Solver::DropPose(int index) -> void
+{
+  // Pairs with a pose dropped earlier were already taken out.
+  for (const int pair : pose_pairs_[index])
+  {
+    if (IsActive(pairs_[pair]))
+    {
+      DropPair(pair);
+    }
+  }
+  poses_[index].points.resize(0, 3);
+  pose_pairs_[index] = std::vector<int>();
+  if (index == reference_pose_)
+  {
+    reference_pose_ = -1;
+  }
+}
+
+auto Solver::EvictPoses() -> void
+{
+  if (max_poses_ <= 0)
+  {
+    return;
+  }
+
+  while (WindowSize() > max_poses_)
+  {
+    if (first_pose_ != reference_pose_)
+    {
+      DropPose(first_pose_);
+    }
+    ++first_pose_;
+  }
+  RebuildProblemIfSparse();
+}
+
+auto Solver::RejectOutliers() -> void
+{
+  if (outlier_options_.method == OutlierRejection::NONE)
+  {
+    return;
+  }
+  if (!hand_eye_calibration::RejectOutliers(poses_, pairs_, outlier_options_, num_threads_, &outlier_summary_))
+  {
+    return;
+  }
+
+  // Poses outside the window, other than the reference pose, have no points.
+  for (int index = 0; index < static_cast<int>(poses_.size()); ++index)
+  {
+    if (!outlier_summary_.pose_inliers(index) && poses_[index].points.rows() > 0)
+    {
+      DropPose(index);
+    }
+  }
+
+  // Outlier pairs between inlier poses are dropped and, since their poses stay
+  // active, erased right away so they are not built again.
+  std::vector<bool> keep(pairs_.size());
+  for (std::size_t index = 0; index < pairs_.size(); ++index)
+  {
+    keep[index] = IsActive(pairs_[index]);
+    if (keep[index] && !outlier_summary_.pair_inliers(index))
+    {
+      DropPair(static_cast<int>(index));
+      keep[index] = false;
+    }
+  }
+  ErasePairs(keep);
+  RebuildProblemIfSparse();
+
+  // The estimate refitted to the inliers is a better start than the
+  // closed-form one over every pair.
+  if (needs_initialization_)
+  {
+    q_opt_ = outlier_summary_.q;
+    t_opt_ = outlier_summary_.t;
+    needs_initialization_ = false;
+  }
+}
+
+auto Solver::RebuildProblemIfSparse() -> void
+{
+  // Removed cost functions stay in the arenas, and evicted poses and inactive
+  // pairs in the bookkeeping, until the problem is rebuilt, which happens once
+  // they outnumber the live ones.
+  const bool sparse_problem = num_evicted_blocks_ > 0 && num_evicted_blocks_ >= static_cast<std::size_t>(problem_->NumResidualBlocks());
+  const bool sparse_window = first_pose_ > WindowSize() || static_cast<int>(pairs_.size()) - num_active_pairs_ > num_active_pairs_;
+  if (sparse_problem || sparse_window)
+  {
+    RebuildProblem();
+  }
+}
+
+auto Solver::RebuildProblem() -> void
+{
+  problem_ = std::make_unique<ceres::Problem>(ProblemOptions());
+  functors_.Clear();
+  cost_functions_.Clear();
+  pair_cost_functions_.Clear();
+  local_parameterization_is_set_ = false;
+  num_evicted_blocks_ = 0;
+
+  CompactWindow();
+  pair_blocks_.assign(pairs_.size(), std::vector<Block>());
+  num_pairs_in_problem_ = 0;
+
+  // Recomputed from the active pairs on the next SUFFICIENT_STATISTICS solve,
+  // which also discards the rounding error left by subtracting dropped pairs.
+  gram_ = loose_gram_;
+  num_pairs_in_gram_ = 0;
+
+  // Blocks added through AddResidualBlock, in the order they were added.
+  for (std::size_t k = 0; k < loose_cost_functions_.Size(); ++k)
+  {
+    problem_->AddResidualBlock(loose_cost_functions_.At(k), loss_function_.get(), q_opt_.data(), t_opt_.data());
+  }
+}
+
+auto Solver::ErasePairs(const std::vector<bool>& keep) -> void
+{
+  // Keeps the order and the residual blocks of the remaining pairs, so the
+  // ones already in the problem and the Gram matrix still form a prefix.
+  std::vector<int> remap(pairs_.size(), -1);
+  const std::size_t num_pairs_in_problem = num_pairs_in_problem_;
+  const std::size_t num_pairs_in_gram = num_pairs_in_gram_;
+  std::size_t num_pairs = 0;
+  for (std::size_t index = 0; index < pairs_.size(); ++index)
+  {
+    if (!keep[index])
+    {
+      num_pairs_in_problem_ -= index < num_pairs_in_problem ? 1 : 0;
+      num_pairs_in_gram_ -= index < num_pairs_in_gram ? 1 : 0;
+      continue;
+    }
+    remap[index] = static_cast<int>(num_pairs);
+    pairs_[num_pairs] = pairs_[index];
+    pair_blocks_[num_pairs] = std::move(pair_blocks_[index]);
+    ++num_pairs;
+  }
+  pairs_.resize(num_pairs);
+  pair_blocks_.resize(num_pairs);
+
+  for (std::vector<int>& pose_pairs : pose_pairs_)
+  {
+    pose_pairs.erase(std::remove_if(pose_pairs.begin(), pose_pairs.end(), [&](int pair) { return remap[pair] < 0; }), pose_pairs.end());
+    for (int& pair : pose_pairs)
+    {
+      pair = remap[pair];
+    }
+  }
+}
+
+auto Solver::CompactWindow() -> void
+{
+  // Keeps the poses in the window, in order, and the pairs between poses that
+  // still have points.
+  std::vector<bool> keep(pairs_.size());
+  for (std::size_t index = 0; index < pairs_.size(); ++index)
+  {
+    keep[index] = IsActive(pairs_[index]);
+  }
+  ErasePairs(keep);
+
+  std::vector<int> remap(poses_.size(), -1);
+  int num_poses = 0;
+  for (int index = 0; index < static_cast<int>(poses_.size()); ++index)
+  {
+    if (index >= first_pose_ || index == reference_pose_)
+    {
+      remap[index] = num_poses++;
+    }
+  }
+  for (PosePair& pair : pairs_)
+  {
+    pair = PosePair(remap[pair.first], remap[pair.second]);
+  }
+  for (int index = 0; index < static_cast<int>(poses_.size()); ++index)
+  {
+    if (remap[index] >= 0 && remap[index] != index)
+    {
+      poses_[remap[index]] = std::move(poses_[index]);
+      pose_pairs_[remap[index]] = std::move(pose_pairs_[index]);
+    }
+  }
+  poses_.resize(num_poses);
+  pose_pairs_.resize(num_poses);
+
+  first_pose_ = num_poses - (static_cast<int>(remap.size()) - first_pose_);
+  if (reference_pose_ >= 0)
+  {
+    reference_pose_ = remap[reference_pose_];
+  }
+}
+
+auto Solver::SetMaxPoses(int max_poses) -> void
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_poses_ = max_poses;
+  EvictPoses();
+}
+
+auto Solver::NumPoses() const -> int
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return WindowSize();
+}
+
+auto Solver::WindowSize() const -> int
+{
+  const bool has_reference_behind = reference_pose_ >= 0 && reference_pose_ < first_pose_;
+  return static_cast<int>(poses_.size()) - first_pose_ + (has_reference_behind ? 1 : 0);
+}
+
+auto Solver::SetPairOptions(const PairOptions& options) -> void
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (options.k < 1)
+  {
+    throw std::invalid_argument("k must be at least 1");
+  }
+  if (options.num_pairs < 0)
+  {
+    throw std::invalid_argument("num_pairs must be non-negative");
+  }
+  if (options.reference < 0)
+  {
+    throw std::invalid_argument("reference must be non-negative");
+  }
+  pair_options_ = options;
+}
+
+auto Solver::NumPairs() const -> int
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_active_pairs_;
+}
+
+auto Solver::EstimatedMemoryInBytes() const -> std::size_t
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  const std::size_t m = std::max<Eigen::Index>(num_points_, 0);
+  const std::size_t num_pairs = num_active_pairs_;
+
+  std::size_t bytes = WindowSize() * (sizeof(Pose) + 3 * m * sizeof(double));
+  if (cost_function_type_ == CostFunctionType::ANALYTIC)
+  {
+    bytes += num_pairs * (sizeof(PairCostFunction) + 6 * m * sizeof(double));
+  }
+  else
+  {
+    bytes += num_pairs * m * (sizeof(CostFunctor) + sizeof(CostFunction));
+  }
+  // Residuals and the dense 7-column Jacobian evaluated by Ceres.
+  bytes += num_pairs * 3 * m * 8 * sizeof(double);
+  return bytes;
+}
+
+auto Solver::SetCostFunctionType(CostFunctionType type) -> void
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  cost_function_type_ = type;
+}
+
+auto Solver::SetNumThreads(int num_threads) -> void
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  num_threads_ = num_threads;
+}
+
+auto Solver::SetLossFunction(LossType type, double scale) -> void
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  loss_function_ = MakeLossFunction(type, scale);
+  pair_loss_function_.reset();
+  loss_type_ = type;
+  loss_scale_ = scale;
+
+  // Blocks already in the problem refer to the previous loss.
+  RebuildProblem();
+}
+
+// For the losses offered, M rho_a(s / M) = rho_{a sqrt(M)}(s), so the loss of a
+// pair block with M corners is M times the loss of its mean squared corner
+// residual.
+auto Solver::PairLossFunction() -> ceres::LossFunction*
+{
+  if (!pair_loss_function_ && loss_type_ != LossType::TRIVIAL)
+  {
+    pair_loss_function_ = MakeLossFunction(loss_type_, loss_scale_ * std::sqrt(static_cast<double>(std::max<Eigen::Index>(num_points_, 1))));
+  }
+  return pair_loss_function_.get();
+}
+
+auto Solver::SetOutlierOptions(const OutlierOptions& options) -> void
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (options.num_samples < 1)
+  {
+    throw std::invalid_argument("num_samples must be at least 1");
+  }
+  if (!(options.threshold > 0.0))
+  {
+    throw std::invalid_argument("threshold must be positive");
+  }
+  if (!(options.min_inlier_ratio >= 0.0 && options.min_inlier_ratio <= 1.0))
+  {
+    throw std::invalid_argument("min_inlier_ratio must be in [0, 1]");
+  }
+  outlier_options_ = options;
+}
+
+auto Solver::OutlierSummary() const -> hand_eye_calibration::OutlierSummary
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return outlier_summary_;
+}
+
+auto Solver::BuildResidualBlocks() -> void
 {
+  const std::size_t num_new_pairs = pairs_.size() - num_pairs_in_problem_;
+  const Eigen::Index m = std::max<Eigen::Index>(num_points_, 0);
+  if (cost_function_type_ == CostFunctionType::ANALYTIC)
+  {
+    pair_cost_functions_.Reserve(num_new_pairs);
+  }
+  else
+  {
+    functors_.Reserve(num_new_pairs * m);
+    cost_functions_.Reserve(num_new_pairs * m);
+  }
+
+  for (std::size_t index = num_pairs_in_problem_; index < pairs_.size(); ++index)
+  {
+    if (!IsActive(pairs_[index]))
+    {
+      continue;
+    }
+    const Pose& pi = poses_[pairs_[index].first];
+    const Pose& pj = poses_[pairs_[index].second];
+    std::vector<Block>& blocks = pair_blocks_[index];
+    if (cost_function_type_ == CostFunctionType::ANALYTIC)
+    {
+      PairCostFunction* cost_function = pair_cost_functions_.Create(pi.R, pi.t, pi.points, pj.R, pj.t, pj.points);
+      ceres::LossFunction* loss_function = PairLossFunction();
+      blocks.push_back(Block{ problem_->AddResidualBlock(cost_function, loss_function, q_opt_.data(), t_opt_.data()), cost_function, loss_function });
+      continue;
+    }
+    blocks.reserve(m);
+    for (Eigen::Index k = 0; k < m; ++k)
+    {
+      const CostFunctor* functor = functors_.Create(pi.q, pi.t, pi.points.row(k).transpose(), pj.q, pj.t, pj.points.row(k).transpose());
+      CostFunction* cost_function = cost_functions_.Create(functor);
+      ceres::LossFunction* loss_function = loss_function_.get();
+      blocks.push_back(Block{ problem_->AddResidualBlock(cost_function, loss_function, q_opt_.data(), t_opt_.data()), cost_function, loss_function });
+    }
+  }
+  num_pairs_in_problem_ = pairs_.size();
+}
+
+auto Solver::UpdateGram() -> void
+{
+  gram_ += AccumulateGram(poses_, pairs_, num_pairs_in_gram_, pairs_.size(), num_threads_);
+  num_pairs_in_gram_ = pairs_.size();
+}
+
+auto Solver::Initialize() -> void
+{
+  if (!needs_initialization_)
+  {
+    return;
+  }
+  // Keeps the current estimate, and tries again on the next solve, if the
+  // motions seen so far do not determine the rotation.
+  needs_initialization_ = !ParkMartin(poses_, pairs_, num_threads_, &q_opt_, &t_opt_);
+}
+
+auto Solver::AddResidualBlocksTo(ceres::Problem* problem, double* q, double* t) -> void
+{
+  for (std::size_t k = 0; k < loose_cost_functions_.Size(); ++k)
+  {
+    problem->AddResidualBlock(loose_cost_functions_.At(k), loss_function_.get(), q, t);
+  }
+  for (const std::vector<Block>& blocks : pair_blocks_)
+  {
+    for (const Block& block : blocks)
+    {
+      problem->AddResidualBlock(block.cost_function, block.loss_function, q, t);
+    }
+  }
+}
+
+auto Solver::SolveGram(const ceres::Solver::Options& options, double* q, double* t, ceres::Solver::Summary* summary) const -> void
+{
+  // A single 13-residual block, independent of the size of the data.
+  ceres::Problem problem;
+  problem.AddResidualBlock(new ceres::AutoDiffCostFunction<GramCostFunctor, 13, 4, 3>(new GramCostFunctor(gram_)), NULL, q, t);
+  problem.SetParameterization(q, new ceres::QuaternionParameterization());
+  ceres::Solve(options, &problem, summary);
+}
+
+auto Solver::Solve(SolveMethod method) -> std::tuple<Eigen::Vector4d, Eigen::Vector3d>
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (method == SolveMethod::SUFFICIENT_STATISTICS && loss_type_ != LossType::TRIVIAL)
+  {
+    throw std::invalid_argument("robust losses require the FULL solve method");
+  }
+
+  RejectOutliers();
+  Initialize();
+
+  if (method == SolveMethod::SUFFICIENT_STATISTICS)
+  {
+    UpdateGram();
+    if (num_active_pairs_ == 0 && loose_cost_functions_.Size() == 0)
+    {
+      throw std::runtime_error("no observations to solve for");
+    }
+    ConfigureOptions(13, 1);
+    SolveGram(options_, q_opt_.data(), t_opt_.data(), &summary_);
+    return std::make_tuple(q_opt_, t_opt_);
+  }
+
+  BuildResidualBlocks();
+  if (problem_->NumResidualBlocks() == 0)
+  {
+    throw std::runtime_error("no observations to solve for");
+  }
+
   if (!local_parameterization_is_set_)
   {
-    problem_.SetParameterization(q_opt_.data(), new ceres::QuaternionParameterization());
+    problem_->SetParameterization(q_opt_.data(), new ceres::QuaternionParameterization());
     local_parameterization_is_set_ = true;
   }
 
-  options_.linear_solver_type = ceres::DENSE_QR;
-  // options_.num_threads = 12;
+  ConfigureOptions(problem_->NumResiduals(), problem_->NumResidualBlocks());
 
-  ceres::Solve(options_, &problem_, &summary_);
-  return std::make_tuple<Eigen::Vector4d, Eigen::Vector3d>(std::move(q_opt_), std::move(t_opt_));
+  // The estimate stays in q_opt_ and t_opt_ so the next solve starts from it.
+  ceres::Solve(options_, problem_.get(), &summary_);
+  return std::make_tuple(q_opt_, t_opt_);
 };
 
+auto Solver::SolveMultiStart(int num_starts, SolveMethod method, std::uint32_t seed) -> std::tuple<Eigen::Vector4d, Eigen::Vector3d>
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (num_starts < 1)
+  {
+    throw std::invalid_argument("num_starts must be at least 1");
+  }
+
+  if (method == SolveMethod::SUFFICIENT_STATISTICS && loss_type_ != LossType::TRIVIAL)
+  {
+    throw std::invalid_argument("robust losses require the FULL solve method");
+  }
+
+  RejectOutliers();
+  Initialize();
+
+  if (method == SolveMethod::SUFFICIENT_STATISTICS)
+  {
+    UpdateGram();
+    if (num_active_pairs_ == 0 && loose_cost_functions_.Size() == 0)
+    {
+      throw std::runtime_error("no observations to solve for");
+    }
+    ConfigureOptions(13, 1);
+  }
+  else
+  {
+    BuildResidualBlocks();
+    if (problem_->NumResidualBlocks() == 0)
+    {
+      throw std::runtime_error("no observations to solve for");
+    }
+    ConfigureOptions(problem_->NumResiduals(), problem_->NumResidualBlocks());
+  }
+
+  hand_eye_calibration::MultiStartSummary& result = multi_start_summary_;
+  result = hand_eye_calibration::MultiStartSummary();
+  result.q.assign(num_starts, q_opt_);
+  result.t.assign(num_starts, t_opt_);
+  result.final_cost.assign(num_starts, 0.0);
+
+  std::mt19937_64 generator(seed);
+  std::normal_distribution<double> normal;
+  for (int k = 1; k < num_starts; ++k)
+  {
+    result.q[k] = Eigen::Vector4d(normal(generator), normal(generator), normal(generator), normal(generator)).normalized();
+  }
+
+  // The starts are independent, so each runs single-threaded on its own
+  // problem. The cost functions are stateless and shared between them, and
+  // the telemetry, which expects a single solve, is left out.
+  ceres::Solver::Options options = options_;
+  options.num_threads = 1;
+  options.callbacks.clear();
+  std::vector<ceres::Solver::Summary> summaries(num_starts);
+  ParallelFor(0, num_starts, num_threads_, [&](int, int k) {
+    if (method == SolveMethod::SUFFICIENT_STATISTICS)
+    {
+      SolveGram(options, result.q[k].data(), result.t[k].data(), &summaries[k]);
+    }
+    else
+    {
+      ceres::Problem problem(ProblemOptions());
+      AddResidualBlocksTo(&problem, result.q[k].data(), result.t[k].data());
+      problem.SetParameterization(result.q[k].data(), new ceres::QuaternionParameterization());
+      ceres::Solve(options, &problem, &summaries[k]);
+    }
+    result.final_cost[k] = summaries[k].final_cost;
+  });
+
+  result.best = static_cast<int>(std::min_element(result.final_cost.begin(), result.final_cost.end()) - result.final_cost.begin());
+  const Eigen::Quaterniond q_best(result.q[result.best](0), result.q[result.best](1), result.q[result.best](2), result.q[result.best](3));
+  for (int k = 0; k < num_starts; ++k)
+  {
+    const Eigen::Quaterniond qk(result.q[k](0), result.q[k](1), result.q[k](2), result.q[k](3));
+    const double angle = qk.normalized().angularDistance(q_best.normalized()) * 180.0 / M_PI;
+    result.rotation_spread = std::max(result.rotation_spread, angle);
+    result.translation_spread = std::max(result.translation_spread, (result.t[k] - result.t[result.best]).norm());
+  }
+
+  q_opt_ = result.q[result.best];
+  t_opt_ = result.t[result.best];
+  summary_ = summaries[result.best];
+  return std::make_tuple(q_opt_, t_opt_);
+}
+
+auto Solver::MultiStartSummary() const -> hand_eye_calibration::MultiStartSummary
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return multi_start_summary_;
+}
+
+auto Solver::SetOptions(const SolverOptions& options) -> void
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  solver_options_ = options;
+}
+
+auto Solver::Telemetry() const -> std::vector<IterationRecord>
+{
+  return telemetry_.Records();
+}
+
+auto Solver::ConfigureOptions(int num_residuals, int num_residual_blocks) -> void
+{
+  const SolverOptions& options = solver_options_;
+
+  options_.linear_solver_type = options.linear_solver_type.value_or(
+      num_residuals > SolverOptions::kMaxDenseQrResiduals ? ceres::DENSE_NORMAL_CHOLESKY : ceres::DENSE_QR);
+
+  options_.num_threads = options.num_threads;
+  if (options_.num_threads <= 0)
+  {
+    const int max_num_threads = num_threads_ > 0 ? num_threads_ : DefaultNumThreads();
+    options_.num_threads = std::clamp(num_residuals / SolverOptions::kResidualsPerThread, 1, std::min(max_num_threads, num_residual_blocks));
+  }
+
+  options_.max_num_iterations = options.max_num_iterations;
+  options_.function_tolerance = options.function_tolerance;
+  options_.gradient_tolerance = options.gradient_tolerance;
+  options_.parameter_tolerance = options.parameter_tolerance;
+  options_.max_solver_time_in_seconds = options.max_solver_time_in_seconds;
+
+  // Ceres reports the initial state as iteration zero.
+  options_.callbacks.clear();
+  if (options.telemetry)
+  {
+    telemetry_.Reset(options.max_num_iterations + 1);
+    options_.callbacks.push_back(&telemetry_);
+  }
+}
+
 auto Solver::Options() -> ceres::Solver::Options
 {
+  std::lock_guard<std::mutex> lock(mutex_);
   return options_;
 }
 
 auto Solver::Summary() -> ceres::Solver::Summary
 {
+  std::lock_guard<std::mutex> lock(mutex_);
   return summary_;
 }
 
@@ -0,0 +1,89 @@
+// Copyright 2020 Norwegian University of Science and Technology.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <eris/sufficient_statistics.hpp>
+
+#include <Eigen/Eigenvalues>
+
+#include <algorithm>
+
+#include <eris/parallel.hpp>
+
+namespace eris::hand_eye_calibration
+{
+auto CornerDesignMatrix(const Eigen::Matrix3d& Ri, const Eigen::Vector3d& ti, const Eigen::Vector3d& pi, const Eigen::Matrix3d& Rj,
+                        const Eigen::Vector3d& tj, const Eigen::Vector3d& pj) -> Eigen::Matrix<double, 3, 13>
+{
+  // R p = (p^T kron I) vec(R).
+  Eigen::Matrix<double, 3, 13> M;
+  for (int n = 0; n < 3; ++n)
+  {
+    M.block<3, 3>(0, 3 * n) = pj(n) * Rj - pi(n) * Ri;
+  }
+  M.block<3, 3>(0, 9) = Rj - Ri;
+  M.col(12) = tj - ti;
+  return M;
+}
+
+auto AccumulateGram(const std::vector<Pose>& poses, const std::vector<PosePair>& pairs, std::size_t begin, std::size_t end, int num_threads)
+    -> GramMatrix
+{
+  if (num_threads <= 0)
+  {
+    num_threads = DefaultNumThreads();
+  }
+
+  // One partial sum and one scratch design matrix per thread, reused for every
+  // pair the thread processes.
+  std::vector<GramMatrix> grams(num_threads, GramMatrix::Zero());
+  std::vector<Eigen::Matrix<double, Eigen::Dynamic, 13>> designs(num_threads);
+
+  ParallelFor(static_cast<int>(begin), static_cast<int>(end), num_threads, [&](int thread_id, int index) {
+    const Pose& pose_i = poses[pairs[index].first];
+    const Pose& pose_j = poses[pairs[index].second];
+    // Poses evicted from a sliding window have no points left and contribute nothing.
+    const Eigen::Index m = std::min(pose_i.points.rows(), pose_j.points.rows());
+    if (m == 0)
+    {
+      return;
+    }
+
+    // Stack the design matrices of all corners and add them with one
+    // symmetric rank-k update.
+    Eigen::Matrix<double, Eigen::Dynamic, 13>& design = designs[thread_id];
+    design.resize(3 * m, 13);
+    for (Eigen::Index k = 0; k < m; ++k)
+    {
+      design.middleRows<3>(3 * k) =
+          CornerDesignMatrix(pose_i.R, pose_i.t, pose_i.points.row(k).transpose(), pose_j.R, pose_j.t, pose_j.points.row(k).transpose());
+    }
+    grams[thread_id].selfadjointView<Eigen::Upper>().rankUpdate(design.transpose());
+  });
+
+  GramMatrix gram = GramMatrix::Zero();
+  for (const GramMatrix& partial : grams)
+  {
+    gram += partial;
+  }
+  return gram.selfadjointView<Eigen::Upper>();
+}
+
+GramCostFunctor::GramCostFunctor(const GramMatrix& gram)
+{
+  // G is positive semi-definite, so S = sqrt(Lambda) V^T satisfies S^T S = G.
+  const Eigen::SelfAdjointEigenSolver<GramMatrix> eigen(gram);
+  const Eigen::Matrix<double, 13, 1> sqrt_eigenvalues = eigen.eigenvalues().cwiseMax(0.0).cwiseSqrt();
+  sqrt_gram_ = sqrt_eigenvalues.asDiagonal() * eigen.eigenvectors().transpose();
+}
+}  // namespace eris::hand_eye_calibration
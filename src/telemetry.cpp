@@ -0,0 +1,62 @@
+// Copyright 2020 Norwegian University of Science and Technology.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <eris/telemetry.hpp>
+
+namespace eris::hand_eye_calibration
+{
+auto ToIterationRecord(const ceres::IterationSummary& summary) -> IterationRecord
+{
+  IterationRecord record;
+  record.iteration = summary.iteration;
+  record.linear_solver_iterations = summary.linear_solver_iterations;
+  record.cost = summary.cost;
+  record.cost_change = summary.cost_change;
+  record.gradient_max_norm = summary.gradient_max_norm;
+  record.step_norm = summary.step_norm;
+  record.trust_region_radius = summary.trust_region_radius;
+  record.iteration_time_in_seconds = summary.iteration_time_in_seconds;
+  record.step_solver_time_in_seconds = summary.step_solver_time_in_seconds;
+  record.cumulative_time_in_seconds = summary.cumulative_time_in_seconds;
+  return record;
+}
+
+auto Telemetry::Reset(std::size_t capacity) -> void
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_.store(0, std::memory_order_release);
+  if (records_.size() < capacity)
+  {
+    records_.resize(capacity);
+  }
+}
+
+auto Telemetry::operator()(const ceres::IterationSummary& summary) -> ceres::CallbackReturnType
+{
+  const std::size_t size = size_.load(std::memory_order_relaxed);
+  if (size < records_.size())
+  {
+    records_[size] = ToIterationRecord(summary);
+    size_.store(size + 1, std::memory_order_release);
+  }
+  return ceres::SOLVER_CONTINUE;
+}
+
+auto Telemetry::Records() const -> std::vector<IterationRecord>
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  const std::size_t size = size_.load(std::memory_order_acquire);
+  return std::vector<IterationRecord>(records_.begin(), records_.begin() + size);
+}
+}  // namespace eris::hand_eye_calibration
@@ -13,14 +13,101 @@
 // limitations under the License.
 
 #include <pybind11/eigen.h>
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include <algorithm>
+#include <optional>
+#include <vector>
+
+#include <eris/batch.hpp>
 #include <eris/solver.hpp>
 
 namespace py = pybind11;
 
-auto SummaryToDict(const ceres::Solver::Summary& summary) -> py::dict
+using DoubleArray = py::array_t<double, py::array::c_style | py::array::forcecast>;
+
+// Views robposes[N, 4, 4] and campoints[N, M, 3] as N x 16 and N x 3M matrices
+// without copying when the arrays are already C-contiguous doubles.
+auto MapObservations(const DoubleArray& robposes, const DoubleArray& campoints) -> eris::hand_eye_calibration::BatchProblem
+{
+  using eris::hand_eye_calibration::RowMatrixXd;
+
+  if (robposes.ndim() != 3 || robposes.shape(1) != 4 || robposes.shape(2) != 4)
+  {
+    throw py::value_error("robposes must have shape (N, 4, 4)");
+  }
+  if (campoints.ndim() != 3 || campoints.shape(0) != robposes.shape(0) || campoints.shape(2) != 3)
+  {
+    throw py::value_error("campoints must have shape (N, M, 3)");
+  }
+
+  return eris::hand_eye_calibration::BatchProblem{ Eigen::Map<const RowMatrixXd>(robposes.data(), robposes.shape(0), 16),
+                                                   Eigen::Map<const RowMatrixXd>(campoints.data(), campoints.shape(0), 3 * campoints.shape(1)) };
+}
+
+auto AddObservations(eris::hand_eye_calibration::Solver& solver, const DoubleArray& robposes, const DoubleArray& campoints,
+                     const std::optional<std::vector<eris::hand_eye_calibration::PosePair>>& pairs) -> bool
+{
+  const eris::hand_eye_calibration::BatchProblem observations = MapObservations(robposes, campoints);
+
+  // The arrays stay referenced by the caller, and the solver may have to wait
+  // for a solve running on another thread.
+  py::gil_scoped_release release;
+  if (pairs)
+  {
+    return solver.AddObservations(observations.robposes, observations.campoints, *pairs);
+  }
+  return solver.AddObservations(observations.robposes, observations.campoints);
+}
+
+// Takes (robposes, campoints) array pairs. The arrays are converted while the
+// GIL is held and are kept alive in problems while the batch runs without it.
+auto CalibrateBatch(const std::vector<std::pair<DoubleArray, DoubleArray>>& problems, int threads,
+                    eris::hand_eye_calibration::SolveMethod method, eris::hand_eye_calibration::CostFunctionType cost_function_type,
+                    const eris::hand_eye_calibration::PairOptions& pair_options, eris::hand_eye_calibration::LossType loss_type,
+                    double loss_scale, const eris::hand_eye_calibration::OutlierOptions& outlier_options,
+                    const eris::hand_eye_calibration::SolverOptions& solver_options) -> eris::hand_eye_calibration::BatchResult
+{
+  std::vector<eris::hand_eye_calibration::BatchProblem> observations;
+  observations.reserve(problems.size());
+  for (const auto& [robposes, campoints] : problems)
+  {
+    observations.push_back(MapObservations(robposes, campoints));
+  }
+
+  eris::hand_eye_calibration::BatchOptions options;
+  options.method = method;
+  options.cost_function_type = cost_function_type;
+  options.pair_options = pair_options;
+  options.loss_type = loss_type;
+  options.loss_scale = loss_scale;
+  options.outlier_options = outlier_options;
+  options.solver_options = solver_options;
+  options.num_threads = threads;
+
+  py::gil_scoped_release release;
+  return eris::hand_eye_calibration::CalibrateBatch(observations, options);
+}
+
+// Copies the records into a NumPy structured array with the same fields.
+auto RecordsToArray(const std::vector<eris::hand_eye_calibration::IterationRecord>& records)
+    -> py::array_t<eris::hand_eye_calibration::IterationRecord>
+{
+  py::array_t<eris::hand_eye_calibration::IterationRecord> array(records.size());
+  std::copy(records.begin(), records.end(), array.mutable_data());
+  return array;
+}
+
+auto Telemetry(const eris::hand_eye_calibration::Solver& solver) -> py::array_t<eris::hand_eye_calibration::IterationRecord>
+{
+  return RecordsToArray(solver.Telemetry());
+}
+
+// The full report and the iterations as Python objects are expensive, so the
+// iterations come as a structured array and the full report only on request.
+auto SummaryToDict(const ceres::Solver::Summary& summary, bool full_report) -> py::dict
 {
   py::dict summary_dict;
   summary_dict[py::str("linear_solver_type_used")] = py::str(ceres::LinearSolverTypeToString(summary.linear_solver_type_used));
@@ -48,37 +135,149 @@ auto SummaryToDict(const ceres::Solver::Summary& summary) -> py::dict
   summary_dict[py::str("num_threads_given")] = py::int_(summary.num_threads_given);
   summary_dict[py::str("num_threads_used")] = py::int_(summary.num_threads_used);
 
-  py::list iterations;
-  auto its = summary.iterations;
-  for (int i = 0; i < its.size(); ++i)
+  std::vector<eris::hand_eye_calibration::IterationRecord> iterations;
+  iterations.reserve(summary.iterations.size());
+  for (const ceres::IterationSummary& iteration : summary.iterations)
   {
-    py::dict iteration;
-    iteration[py::str("iteration")] = py::int_(its[i].iteration);
-    iteration[py::str("cost")] = py::float_(its[i].cost);
-    iteration[py::str("cost_change")] = py::float_(its[i].cost_change);
-    iteration[py::str("gradient_max_norm")] = py::float_(its[i].gradient_max_norm);
-    iteration[py::str("step_norm")] = py::float_(its[i].step_norm);
-    iteration[py::str("relative_decrease")] = py::float_(its[i].relative_decrease);
-    iteration[py::str("trust_region_radius")] = py::float_(its[i].trust_region_radius);
-    iteration[py::str("eta")] = py::float_(its[i].eta);
-    iteration[py::str("linear_solver_iterations")] = py::int_(its[i].linear_solver_iterations);
-    iterations.append(iteration);
+    iterations.push_back(eris::hand_eye_calibration::ToIterationRecord(iteration));
   }
-  summary_dict[py::str("iterations")] = iterations;
+  summary_dict[py::str("iterations")] = RecordsToArray(iterations);
   summary_dict[py::str("brief_report")] = py::str(summary.BriefReport().c_str());
-  summary_dict[py::str("full_report")] = py::str(summary.FullReport().c_str());
+  if (full_report)
+  {
+    summary_dict[py::str("full_report")] = py::str(summary.FullReport().c_str());
+  }
   return summary_dict;
 }
 
 PYBIND11_MODULE(_eris, m)
 {
+  PYBIND11_NUMPY_DTYPE(eris::hand_eye_calibration::IterationRecord, iteration, linear_solver_iterations, cost, cost_change, gradient_max_norm,
+                       step_norm, trust_region_radius, iteration_time_in_seconds, step_solver_time_in_seconds, cumulative_time_in_seconds);
+
   py::class_<ceres::Solver::Summary>(m, "Summary");
 
+  py::enum_<eris::hand_eye_calibration::CostFunctionType>(m, "CostFunctionType")
+      .value("AUTODIFF", eris::hand_eye_calibration::CostFunctionType::AUTODIFF)
+      .value("ANALYTIC", eris::hand_eye_calibration::CostFunctionType::ANALYTIC);
+
+  py::enum_<eris::hand_eye_calibration::SolveMethod>(m, "SolveMethod")
+      .value("FULL", eris::hand_eye_calibration::SolveMethod::FULL)
+      .value("SUFFICIENT_STATISTICS", eris::hand_eye_calibration::SolveMethod::SUFFICIENT_STATISTICS);
+
+  py::enum_<eris::hand_eye_calibration::PairStrategy>(m, "PairStrategy")
+      .value("ALL", eris::hand_eye_calibration::PairStrategy::ALL)
+      .value("CONSECUTIVE", eris::hand_eye_calibration::PairStrategy::CONSECUTIVE)
+      .value("K_NEAREST", eris::hand_eye_calibration::PairStrategy::K_NEAREST)
+      .value("RANDOM", eris::hand_eye_calibration::PairStrategy::RANDOM)
+      .value("REFERENCE", eris::hand_eye_calibration::PairStrategy::REFERENCE);
+
+  py::enum_<ceres::LinearSolverType>(m, "LinearSolverType")
+      .value("DENSE_NORMAL_CHOLESKY", ceres::DENSE_NORMAL_CHOLESKY)
+      .value("DENSE_QR", ceres::DENSE_QR)
+      .value("SPARSE_NORMAL_CHOLESKY", ceres::SPARSE_NORMAL_CHOLESKY)
+      .value("CGNR", ceres::CGNR);
+
+  py::class_<eris::hand_eye_calibration::SolverOptions>(m, "SolverOptions")
+      .def(py::init<>())
+      .def_readwrite("linear_solver_type", &eris::hand_eye_calibration::SolverOptions::linear_solver_type)
+      .def_readwrite("num_threads", &eris::hand_eye_calibration::SolverOptions::num_threads)
+      .def_readwrite("max_num_iterations", &eris::hand_eye_calibration::SolverOptions::max_num_iterations)
+      .def_readwrite("function_tolerance", &eris::hand_eye_calibration::SolverOptions::function_tolerance)
+      .def_readwrite("gradient_tolerance", &eris::hand_eye_calibration::SolverOptions::gradient_tolerance)
+      .def_readwrite("parameter_tolerance", &eris::hand_eye_calibration::SolverOptions::parameter_tolerance)
+      .def_readwrite("max_solver_time_in_seconds", &eris::hand_eye_calibration::SolverOptions::max_solver_time_in_seconds)
+      .def_readwrite("telemetry", &eris::hand_eye_calibration::SolverOptions::telemetry);
+
+  py::enum_<eris::hand_eye_calibration::LossType>(m, "LossType")
+      .value("TRIVIAL", eris::hand_eye_calibration::LossType::TRIVIAL)
+      .value("HUBER", eris::hand_eye_calibration::LossType::HUBER)
+      .value("CAUCHY", eris::hand_eye_calibration::LossType::CAUCHY)
+      .value("TUKEY", eris::hand_eye_calibration::LossType::TUKEY);
+
+  py::enum_<eris::hand_eye_calibration::OutlierRejection>(m, "OutlierRejection")
+      .value("NONE", eris::hand_eye_calibration::OutlierRejection::NONE)
+      .value("RANSAC", eris::hand_eye_calibration::OutlierRejection::RANSAC)
+      .value("LMEDS", eris::hand_eye_calibration::OutlierRejection::LMEDS);
+
+  py::class_<eris::hand_eye_calibration::OutlierOptions>(m, "OutlierOptions")
+      .def(py::init<>())
+      .def_readwrite("method", &eris::hand_eye_calibration::OutlierOptions::method)
+      .def_readwrite("num_samples", &eris::hand_eye_calibration::OutlierOptions::num_samples)
+      .def_readwrite("threshold", &eris::hand_eye_calibration::OutlierOptions::threshold)
+      .def_readwrite("min_inlier_ratio", &eris::hand_eye_calibration::OutlierOptions::min_inlier_ratio)
+      .def_readwrite("seed", &eris::hand_eye_calibration::OutlierOptions::seed);
+
+  py::class_<eris::hand_eye_calibration::OutlierSummary>(m, "OutlierSummary")
+      .def_readonly("pose_inliers", &eris::hand_eye_calibration::OutlierSummary::pose_inliers)
+      .def_readonly("pair_inliers", &eris::hand_eye_calibration::OutlierSummary::pair_inliers)
+      .def_readonly("pair_residuals", &eris::hand_eye_calibration::OutlierSummary::pair_residuals)
+      .def_readonly("pose_residual_median", &eris::hand_eye_calibration::OutlierSummary::pose_residual_median)
+      .def_readonly("pose_residual_max", &eris::hand_eye_calibration::OutlierSummary::pose_residual_max)
+      .def_readonly("threshold", &eris::hand_eye_calibration::OutlierSummary::threshold);
+
+  py::class_<eris::hand_eye_calibration::MultiStartSummary>(m, "MultiStartSummary")
+      .def_readonly("best", &eris::hand_eye_calibration::MultiStartSummary::best)
+      .def_readonly("q", &eris::hand_eye_calibration::MultiStartSummary::q)
+      .def_readonly("t", &eris::hand_eye_calibration::MultiStartSummary::t)
+      .def_readonly("final_cost", &eris::hand_eye_calibration::MultiStartSummary::final_cost)
+      .def_readonly("rotation_spread", &eris::hand_eye_calibration::MultiStartSummary::rotation_spread)
+      .def_readonly("translation_spread", &eris::hand_eye_calibration::MultiStartSummary::translation_spread);
+
+  py::class_<eris::hand_eye_calibration::BatchResult>(m, "BatchResult")
+      .def_readonly("q", &eris::hand_eye_calibration::BatchResult::q)
+      .def_readonly("t", &eris::hand_eye_calibration::BatchResult::t)
+      .def_readonly("initial_cost", &eris::hand_eye_calibration::BatchResult::initial_cost)
+      .def_readonly("final_cost", &eris::hand_eye_calibration::BatchResult::final_cost)
+      .def_readonly("num_iterations", &eris::hand_eye_calibration::BatchResult::num_iterations)
+      .def_readonly("num_pairs", &eris::hand_eye_calibration::BatchResult::num_pairs)
+      .def_readonly("time_in_seconds", &eris::hand_eye_calibration::BatchResult::time_in_seconds)
+      .def_readonly("converged", &eris::hand_eye_calibration::BatchResult::converged);
+
+  py::class_<eris::hand_eye_calibration::PairOptions>(m, "PairOptions")
+      .def(py::init<>())
+      .def_readwrite("strategy", &eris::hand_eye_calibration::PairOptions::strategy)
+      .def_readwrite("k", &eris::hand_eye_calibration::PairOptions::k)
+      .def_readwrite("rotation_weight", &eris::hand_eye_calibration::PairOptions::rotation_weight)
+      .def_readwrite("num_pairs", &eris::hand_eye_calibration::PairOptions::num_pairs)
+      .def_readwrite("seed", &eris::hand_eye_calibration::PairOptions::seed)
+      .def_readwrite("reference", &eris::hand_eye_calibration::PairOptions::reference);
+
+  // Every method but telemetry may wait for a solve running on another thread,
+  // so they release the GIL while they run.
   py::class_<eris::hand_eye_calibration::Solver>(m, "Solver")
+      .def(py::init<>())
       .def(py::init<const Eigen::Vector4d&, const Eigen::Vector3d&>())
-      .def("add_residual_block", &eris::hand_eye_calibration::Solver::AddResidualBlock)
-      .def("solve", &eris::hand_eye_calibration::Solver::Solve)
-      .def("summary", &eris::hand_eye_calibration::Solver::Summary);
+      .def("add_residual_block", &eris::hand_eye_calibration::Solver::AddResidualBlock, py::call_guard<py::gil_scoped_release>())
+      .def("add_observations", &AddObservations, py::arg("robposes"), py::arg("campoints"), py::arg("pairs") = py::none())
+      .def("add_pose", &eris::hand_eye_calibration::Solver::AddPose, py::arg("robpose"), py::arg("campoints"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("set_max_poses", &eris::hand_eye_calibration::Solver::SetMaxPoses, py::call_guard<py::gil_scoped_release>())
+      .def("num_poses", &eris::hand_eye_calibration::Solver::NumPoses, py::call_guard<py::gil_scoped_release>())
+      .def("set_pair_options", &eris::hand_eye_calibration::Solver::SetPairOptions, py::call_guard<py::gil_scoped_release>())
+      .def("num_pairs", &eris::hand_eye_calibration::Solver::NumPairs, py::call_guard<py::gil_scoped_release>())
+      .def("estimated_memory_in_bytes", &eris::hand_eye_calibration::Solver::EstimatedMemoryInBytes, py::call_guard<py::gil_scoped_release>())
+      .def("set_cost_function_type", &eris::hand_eye_calibration::Solver::SetCostFunctionType, py::call_guard<py::gil_scoped_release>())
+      .def("set_num_threads", &eris::hand_eye_calibration::Solver::SetNumThreads, py::call_guard<py::gil_scoped_release>())
+      .def("set_options", &eris::hand_eye_calibration::Solver::SetOptions, py::call_guard<py::gil_scoped_release>())
+      .def("telemetry", &Telemetry)
+      .def("set_loss_function", &eris::hand_eye_calibration::Solver::SetLossFunction, py::arg("type"), py::arg("scale") = 1.0,
+           py::call_guard<py::gil_scoped_release>())
+      .def("set_outlier_options", &eris::hand_eye_calibration::Solver::SetOutlierOptions, py::call_guard<py::gil_scoped_release>())
+      .def("outlier_summary", &eris::hand_eye_calibration::Solver::OutlierSummary, py::call_guard<py::gil_scoped_release>())
+      .def("solve", &eris::hand_eye_calibration::Solver::Solve, py::arg("method") = eris::hand_eye_calibration::SolveMethod::FULL,
+           py::call_guard<py::gil_scoped_release>())
+      .def("solve_multi_start", &eris::hand_eye_calibration::Solver::SolveMultiStart, py::arg("num_starts"),
+           py::arg("method") = eris::hand_eye_calibration::SolveMethod::FULL, py::arg("seed") = 0, py::call_guard<py::gil_scoped_release>())
+      .def("multi_start_summary", &eris::hand_eye_calibration::Solver::MultiStartSummary, py::call_guard<py::gil_scoped_release>())
+      .def("summary", &eris::hand_eye_calibration::Solver::Summary, py::call_guard<py::gil_scoped_release>());
 
-  m.def("summary_to_dict", &SummaryToDict);
+  m.def("summary_to_dict", &SummaryToDict, py::arg("summary"), py::arg("full_report") = false);
+  m.def("calibrate_batch", &CalibrateBatch, py::arg("problems"), py::arg("threads") = 0,
+        py::arg("method") = eris::hand_eye_calibration::SolveMethod::FULL,
+        py::arg("cost_function_type") = eris::hand_eye_calibration::CostFunctionType::AUTODIFF,
+        py::arg("pair_options") = eris::hand_eye_calibration::PairOptions(),
+        py::arg("loss_type") = eris::hand_eye_calibration::LossType::TRIVIAL, py::arg("loss_scale") = 1.0,
+        py::arg("outlier_options") = eris::hand_eye_calibration::OutlierOptions(),
+        py::arg("solver_options") = eris::hand_eye_calibration::SolverOptions());
 }
\ No newline at end of file
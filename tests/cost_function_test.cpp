@@ -0,0 +1,138 @@
+// Copyright 2020 Norwegian University of Science and Technology.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <Eigen/Geometry>
+
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <eris/solver.hpp>
+
+namespace eris::hand_eye_calibration
+{
+namespace
+{
+using AutoDiffCostFunction = BorrowedAutoDiffCostFunction<CostFunctor, 3, 4, 3>;
+using RowJacobian = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+auto RandomRotation(std::mt19937& generator) -> Eigen::Quaterniond
+{
+  std::normal_distribution<double> normal;
+  return Eigen::Quaterniond(normal(generator), normal(generator), normal(generator), normal(generator)).normalized();
+}
+
+// Evaluates PairCostFunction for a random pose pair at (q, t) and compares it
+// with one autodiff CostFunctor per corner.
+auto ExpectAgreement(const Eigen::Vector4d& q, const Eigen::Vector3d& t, std::mt19937& generator) -> void
+{
+  constexpr int kNumCorners = 7;
+  const Eigen::Quaterniond qi = RandomRotation(generator);
+  const Eigen::Quaterniond qj = RandomRotation(generator);
+  const Eigen::Vector4d qi_wxyz(qi.w(), qi.x(), qi.y(), qi.z());
+  const Eigen::Vector4d qj_wxyz(qj.w(), qj.x(), qj.y(), qj.z());
+  const Eigen::Vector3d ti = Eigen::Vector3d::Random();
+  const Eigen::Vector3d tj = Eigen::Vector3d::Random();
+  const Points pi = Points::Random(kNumCorners, 3);
+  const Points pj = Points::Random(kNumCorners, 3);
+
+  const PairCostFunction analytic(qi.toRotationMatrix(), ti, pi, qj.toRotationMatrix(), tj, pj);
+  ASSERT_EQ(analytic.num_residuals(), 3 * kNumCorners);
+
+  const double* parameters[] = { q.data(), t.data() };
+  Eigen::VectorXd residuals(3 * kNumCorners);
+  RowJacobian dq(3 * kNumCorners, 4);
+  RowJacobian dt(3 * kNumCorners, 3);
+  double* jacobians[] = { dq.data(), dt.data() };
+  ASSERT_TRUE(analytic.Evaluate(parameters, residuals.data(), jacobians));
+
+  for (int k = 0; k < kNumCorners; ++k)
+  {
+    const CostFunctor functor(qi_wxyz, ti, pi.row(k).transpose(), qj_wxyz, tj, pj.row(k).transpose());
+    const AutoDiffCostFunction autodiff(&functor);
+    Eigen::Vector3d expected_residuals;
+    Eigen::Matrix<double, 3, 4, Eigen::RowMajor> expected_dq;
+    Eigen::Matrix<double, 3, 3, Eigen::RowMajor> expected_dt;
+    double* expected_jacobians[] = { expected_dq.data(), expected_dt.data() };
+    ASSERT_TRUE(autodiff.Evaluate(parameters, expected_residuals.data(), expected_jacobians));
+
+    const double tolerance = 1e-12;
+    EXPECT_TRUE(residuals.segment<3>(3 * k).isApprox(expected_residuals, tolerance)) << "corner " << k;
+    EXPECT_TRUE(dq.middleRows<3>(3 * k).isApprox(expected_dq, tolerance)) << "corner " << k;
+    EXPECT_TRUE(dt.middleRows<3>(3 * k).isApprox(expected_dt, tolerance)) << "corner " << k;
+  }
+
+  // Residuals alone, as Ceres evaluates them in line searches.
+  Eigen::VectorXd residuals_only(3 * kNumCorners);
+  ASSERT_TRUE(analytic.Evaluate(parameters, residuals_only.data(), nullptr));
+  EXPECT_TRUE(residuals_only.isApprox(residuals, 1e-15));
+}
+
+TEST(PairCostFunction, MatchesAutoDiffAtUnitQuaternions)
+{
+  std::mt19937 generator(1);
+  for (int trial = 0; trial < 20; ++trial)
+  {
+    const Eigen::Quaterniond q = RandomRotation(generator);
+    ExpectAgreement(Eigen::Vector4d(q.w(), q.x(), q.y(), q.z()), Eigen::Vector3d::Random(), generator);
+  }
+}
+
+// Ceres normalizes the quaternion inside QuaternionRotatePoint, so the
+// Jacobians differ from those at the normalized quaternion.
+TEST(PairCostFunction, MatchesAutoDiffAtNonUnitQuaternions)
+{
+  std::mt19937 generator(2);
+  std::uniform_real_distribution<double> scale(0.2, 5.0);
+  for (int trial = 0; trial < 20; ++trial)
+  {
+    const Eigen::Quaterniond q = RandomRotation(generator);
+    ExpectAgreement(scale(generator) * Eigen::Vector4d(q.w(), q.x(), q.y(), q.z()), Eigen::Vector3d::Random(), generator);
+  }
+}
+
+// ANALYTIC blocks use the loss with scale * sqrt(M), relying on
+// M rho_a(s / M) = rho_{a sqrt(M)}(s) and its derivatives in s.
+TEST(PairLoss, ScaledLossMatchesLossOfMeanCornerResidual)
+{
+  const double scale = 0.01;
+  for (const int m : { 1, 7, 60 })
+  {
+    const std::unique_ptr<ceres::LossFunction> corner_losses[] = { std::make_unique<ceres::HuberLoss>(scale),
+                                                                   std::make_unique<ceres::CauchyLoss>(scale),
+                                                                   std::make_unique<ceres::TukeyLoss>(scale) };
+    const double pair_scale = scale * std::sqrt(static_cast<double>(m));
+    const std::unique_ptr<ceres::LossFunction> pair_losses[] = { std::make_unique<ceres::HuberLoss>(pair_scale),
+                                                                 std::make_unique<ceres::CauchyLoss>(pair_scale),
+                                                                 std::make_unique<ceres::TukeyLoss>(pair_scale) };
+    for (int type = 0; type < 3; ++type)
+    {
+      for (const double rms : { 1e-4, 5e-3, 2e-2, 1.0 })
+      {
+        const double s = m * rms * rms;
+        double corner[3];
+        double pair[3];
+        corner_losses[type]->Evaluate(s / m, corner);
+        pair_losses[type]->Evaluate(s, pair);
+        EXPECT_NEAR(pair[0], m * corner[0], 1e-12 * std::abs(pair[0])) << "loss " << type << " m " << m << " rms " << rms;
+        EXPECT_NEAR(pair[1], corner[1], 1e-12 * std::abs(pair[1]) + 1e-300) << "loss " << type << " m " << m << " rms " << rms;
+        EXPECT_NEAR(pair[2], corner[2] / m, 1e-9 * std::abs(pair[2]) + 1e-300) << "loss " << type << " m " << m << " rms " << rms;
+      }
+    }
+  }
+}
+}  // namespace
+}  // namespace eris::hand_eye_calibration
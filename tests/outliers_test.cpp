@@ -0,0 +1,200 @@
+// Copyright 2020 Norwegian University of Science and Technology.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <gtest/gtest.h>
+#include <Eigen/Geometry>
+
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include <eris/batch.hpp>
+#include <eris/outliers.hpp>
+#include <eris/solver.hpp>
+
+#include "synthetic_problem.hpp"
+
+namespace eris::hand_eye_calibration
+{
+namespace
+{
+constexpr int kNumPoses = 30;
+
+// Every eighth robot pose is stale, off by 0.3 rad, as when the robot state
+// is read before the motion settles.
+auto IsCorrupted(int pose) -> bool
+{
+  return pose % 8 == 3;
+}
+
+auto MakeCorruptedProblem() -> Problem
+{
+  Problem problem = MakeProblem(kNumPoses, 60, 1e-3, 7);
+  for (int i = 0; i < kNumPoses; ++i)
+  {
+    if (IsCorrupted(i))
+    {
+      Eigen::Map<Eigen::Matrix<double, 4, 4, Eigen::RowMajor>> robpose(problem.robposes.row(i).data());
+      robpose.topLeftCorner<3, 3>() *= Eigen::AngleAxisd(0.3, Eigen::Vector3d(1.0, 2.0, 2.0) / 3.0).toRotationMatrix();
+    }
+  }
+  return problem;
+}
+
+auto AllPairs(int num_poses) -> std::vector<PosePair>
+{
+  std::vector<PosePair> pairs;
+  for (int i = 0; i < num_poses; ++i)
+  {
+    for (int j = i + 1; j < num_poses; ++j)
+    {
+      pairs.emplace_back(i, j);
+    }
+  }
+  return pairs;
+}
+
+auto IsCorrupted(const PosePair& pair) -> bool
+{
+  return IsCorrupted(pair.first) || IsCorrupted(pair.second);
+}
+
+auto Options(OutlierRejection method, double min_inlier_ratio) -> OutlierOptions
+{
+  OutlierOptions options;
+  options.method = method;
+  options.num_samples = 300;
+  options.threshold = 0.01;
+  options.min_inlier_ratio = min_inlier_ratio;
+  options.seed = 1;
+  return options;
+}
+
+class OutlierRejectionTest : public ::testing::TestWithParam<OutlierRejection>
+{
+};
+
+TEST_P(OutlierRejectionTest, RejectsStaleRobotPoses)
+{
+  const Problem problem = MakeCorruptedProblem();
+  const std::vector<PosePair> pairs = AllPairs(kNumPoses);
+
+  Solver solver;
+  solver.SetOutlierOptions(Options(GetParam(), 0.5));
+  solver.AddObservations(problem.robposes, problem.campoints, pairs);
+  solver.Solve(SolveMethod::SUFFICIENT_STATISTICS);
+
+  const auto summary = solver.OutlierSummary();
+  ASSERT_EQ(summary.pose_inliers.size(), kNumPoses);
+  ASSERT_EQ(summary.pair_inliers.size(), static_cast<int>(pairs.size()));
+  for (int i = 0; i < kNumPoses; ++i)
+  {
+    EXPECT_EQ(summary.pose_inliers(i), !IsCorrupted(i)) << "pose " << i;
+  }
+  for (std::size_t index = 0; index < pairs.size(); ++index)
+  {
+    if (IsCorrupted(pairs[index]))
+    {
+      EXPECT_FALSE(summary.pair_inliers(index)) << "pair " << index;
+    }
+  }
+  EXPECT_EQ(solver.NumPairs(), summary.pair_inliers.count());
+}
+
+// With no minimum inlier ratio every pose stays, and only the pairs through the
+// stale poses are dropped. Their blocks and Gram matrix terms must be gone, so
+// both solve methods see the same problem as a solver given only the inliers.
+TEST_P(OutlierRejectionTest, DropsOutlierPairsBetweenInlierPoses)
+{
+  const Problem problem = MakeCorruptedProblem();
+  const std::vector<PosePair> pairs = AllPairs(kNumPoses);
+  const Eigen::Vector4d q_init(1.0, 0.0, 0.0, 0.0);
+  const Eigen::Vector3d t_init = Eigen::Vector3d::Zero();
+
+  for (const auto method : { SolveMethod::FULL, SolveMethod::SUFFICIENT_STATISTICS })
+  {
+    Solver rejecting(q_init, t_init);
+    rejecting.SetOutlierOptions(Options(GetParam(), 0.0));
+    rejecting.AddObservations(problem.robposes, problem.campoints, pairs);
+    rejecting.Solve(method);
+
+    const auto summary = rejecting.OutlierSummary();
+    ASSERT_EQ(summary.pose_inliers.count(), kNumPoses);
+    ASSERT_LT(summary.pair_inliers.count(), static_cast<int>(pairs.size()));
+    std::vector<PosePair> inlier_pairs;
+    for (std::size_t index = 0; index < pairs.size(); ++index)
+    {
+      EXPECT_FALSE(IsCorrupted(pairs[index]) && summary.pair_inliers(index)) << "pair " << index;
+      if (summary.pair_inliers(index))
+      {
+        inlier_pairs.push_back(pairs[index]);
+      }
+    }
+    Solver fresh(q_init, t_init);
+    fresh.AddObservations(problem.robposes, problem.campoints, inlier_pairs);
+    fresh.Solve(method);
+
+    EXPECT_EQ(rejecting.NumPairs(), fresh.NumPairs());
+    EXPECT_EQ(rejecting.Summary().num_residual_blocks, fresh.Summary().num_residual_blocks);
+    EXPECT_EQ(rejecting.Summary().num_residuals, fresh.Summary().num_residuals);
+    EXPECT_NEAR(rejecting.Summary().initial_cost, fresh.Summary().initial_cost, 1e-9 * fresh.Summary().initial_cost);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Methods, OutlierRejectionTest, ::testing::Values(OutlierRejection::RANSAC, OutlierRejection::LMEDS),
+                         [](const ::testing::TestParamInfo<OutlierRejection>& info) {
+                           return info.param == OutlierRejection::LMEDS ? "LMedS" : "RANSAC";
+                         });
+
+TEST(OutlierRejection, KeepsPosesWithoutScoredPairs)
+{
+  const Problem problem = MakeProblem(8, 30, 1e-3, 8);
+  const std::vector<PosePair> pairs = AllPairs(7);
+
+  Solver solver;
+  solver.SetOutlierOptions(Options(OutlierRejection::RANSAC, 0.5));
+  solver.AddObservations(problem.robposes, problem.campoints, pairs);
+  solver.Solve(SolveMethod::SUFFICIENT_STATISTICS);
+
+  const auto summary = solver.OutlierSummary();
+  ASSERT_EQ(summary.pose_inliers.size(), 8);
+  EXPECT_EQ(summary.pose_inliers.count(), 8);
+  EXPECT_TRUE(std::isnan(summary.pose_residual_median(7)));
+  EXPECT_EQ(solver.NumPairs(), static_cast<int>(pairs.size()));
+}
+
+TEST(OutlierRejection, ThrowsOnInvalidOptions)
+{
+  std::vector<OutlierOptions> invalid(5, Options(OutlierRejection::RANSAC, 0.5));
+  invalid[0].num_samples = 0;
+  invalid[1].num_samples = -3;
+  invalid[2].threshold = 0.0;
+  invalid[3].min_inlier_ratio = 1.5;
+  invalid[4].min_inlier_ratio = -0.1;
+
+  const Problem problem = MakeProblem(4, 30, 1e-3, 9);
+  const std::vector<BatchProblem> problems{ { Eigen::Map<const RowMatrixXd>(problem.robposes.data(), 4, 16),
+                                              Eigen::Map<const RowMatrixXd>(problem.campoints.data(), 4, 90) } };
+  for (const auto& options : invalid)
+  {
+    Solver solver;
+    EXPECT_THROW(solver.SetOutlierOptions(options), std::invalid_argument);
+
+    BatchOptions batch_options;
+    batch_options.outlier_options = options;
+    EXPECT_THROW(CalibrateBatch(problems, batch_options), std::invalid_argument);
+  }
+}
+}  // namespace
+}  // namespace eris::hand_eye_calibration
@@ -0,0 +1,89 @@
+// Copyright 2020 Norwegian University of Science and Technology.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <Eigen/Geometry>
+
+#include <vector>
+
+#include <eris/pairs.hpp>
+
+namespace eris::hand_eye_calibration
+{
+namespace
+{
+auto MakePoses(int num_poses) -> std::vector<Pose>
+{
+  std::vector<Pose> poses(num_poses);
+  for (int i = 0; i < num_poses; ++i)
+  {
+    const Eigen::Quaterniond q = Eigen::Quaterniond::UnitRandom();
+    poses[i].q << q.w(), q.x(), q.y(), q.z();
+    poses[i].R = q.toRotationMatrix();
+    poses[i].t = Eigen::Vector3d::Random();
+    poses[i].points = Points::Random(4, 3);
+  }
+  return poses;
+}
+
+class NewPosePairsTest : public ::testing::TestWithParam<PairStrategy>
+{
+};
+
+// A new pose spends none of its partners on poses dropped from the window.
+TEST_P(NewPosePairsTest, SkipsDroppedPoses)
+{
+  std::vector<Pose> poses = MakePoses(10);
+  for (const int dropped : { 2, 5, 6, 7, 8 })
+  {
+    poses[dropped].points.resize(0, 3);
+  }
+
+  PairOptions options;
+  options.strategy = GetParam();
+  options.k = 3;
+  const std::vector<PosePair> pairs = SelectPairsForNewPose(poses, 0, 9, options);
+  ASSERT_FALSE(pairs.empty());
+  for (const auto& [i, j] : pairs)
+  {
+    EXPECT_EQ(j, 9);
+    EXPECT_GT(poses[i].points.rows(), 0) << "paired with dropped pose " << i;
+  }
+  if (options.strategy == PairStrategy::K_NEAREST || options.strategy == PairStrategy::RANDOM)
+  {
+    EXPECT_EQ(pairs.size(), 3u);
+  }
+  if (options.strategy == PairStrategy::CONSECUTIVE)
+  {
+    EXPECT_EQ(pairs.front().first, 4);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(PairStrategies, NewPosePairsTest,
+                         ::testing::Values(PairStrategy::ALL, PairStrategy::CONSECUTIVE, PairStrategy::K_NEAREST, PairStrategy::RANDOM),
+                         [](const ::testing::TestParamInfo<PairStrategy>& info) {
+                           switch (info.param)
+                           {
+                             case PairStrategy::ALL:
+                               return "All";
+                             case PairStrategy::CONSECUTIVE:
+                               return "Consecutive";
+                             case PairStrategy::K_NEAREST:
+                               return "KNearest";
+                             default:
+                               return "Random";
+                           }
+                         });
+}  // namespace
+}  // namespace eris::hand_eye_calibration
@@ -0,0 +1,213 @@
+// Copyright 2020 Norwegian University of Science and Technology.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <Eigen/Geometry>
+
+#include <stdexcept>
+#include <vector>
+
+#include <eris/solver.hpp>
+
+#include "synthetic_problem.hpp"
+
+namespace eris::hand_eye_calibration
+{
+namespace
+{
+// Tight enough for both methods to stop at the same minimum.
+auto TightOptions() -> SolverOptions
+{
+  SolverOptions options;
+  options.max_num_iterations = 200;
+  options.function_tolerance = 1e-14;
+  options.gradient_tolerance = 1e-14;
+  options.parameter_tolerance = 1e-12;
+  return options;
+}
+
+auto RotationAngle(const Eigen::Vector4d& a, const Eigen::Vector4d& b) -> double
+{
+  return Eigen::Quaterniond(a(0), a(1), a(2), a(3)).normalized().angularDistance(Eigen::Quaterniond(b(0), b(1), b(2), b(3)).normalized());
+}
+
+class SufficientStatisticsTest : public ::testing::TestWithParam<CostFunctionType>
+{
+};
+
+TEST_P(SufficientStatisticsTest, MatchesFullSolve)
+{
+  const Problem problem = MakeProblem(12, 30, 1e-3, 3);
+
+  Solver full;
+  full.SetCostFunctionType(GetParam());
+  full.SetOptions(TightOptions());
+  full.AddObservations(problem.robposes, problem.campoints);
+  const auto [q_full, t_full] = full.Solve(SolveMethod::FULL);
+
+  Solver sufficient;
+  sufficient.SetOptions(TightOptions());
+  sufficient.AddObservations(problem.robposes, problem.campoints);
+  const auto [q_sufficient, t_sufficient] = sufficient.Solve(SolveMethod::SUFFICIENT_STATISTICS);
+
+  EXPECT_LT(RotationAngle(q_full, q_sufficient), 1e-7);
+  EXPECT_LT((t_full - t_sufficient).norm(), 1e-7);
+  EXPECT_NEAR(full.Summary().initial_cost, sufficient.Summary().initial_cost, 1e-6 * full.Summary().initial_cost);
+  EXPECT_NEAR(full.Summary().final_cost, sufficient.Summary().final_cost, 1e-6 * full.Summary().final_cost);
+
+  // Both recover the simulated hand-eye transformation up to the noise.
+  const Eigen::Quaterniond q_true(problem.X.linear());
+  EXPECT_LT(RotationAngle(q_full, Eigen::Vector4d(q_true.w(), q_true.x(), q_true.y(), q_true.z())), 1e-2);
+  EXPECT_LT((t_full - problem.X.translation()).norm(), 1e-2);
+}
+
+INSTANTIATE_TEST_SUITE_P(CostFunctionTypes, SufficientStatisticsTest, ::testing::Values(CostFunctionType::AUTODIFF, CostFunctionType::ANALYTIC),
+                         [](const ::testing::TestParamInfo<CostFunctionType>& info) {
+                           return info.param == CostFunctionType::ANALYTIC ? "Analytic" : "AutoDiff";
+                         });
+
+// A window emptied by eviction has nothing to solve for, whatever rounding
+// error subtracting the evicted pairs left in the Gram matrix.
+TEST(SufficientStatistics, ThrowsWithoutActivePairs)
+{
+  const Problem problem = MakeProblem(6, 30, 1e-3, 4);
+
+  Solver solver;
+  solver.AddObservations(problem.robposes, problem.campoints);
+  solver.Solve(SolveMethod::SUFFICIENT_STATISTICS);
+  solver.SetMaxPoses(1);
+  ASSERT_EQ(solver.NumPairs(), 0);
+  EXPECT_THROW(solver.Solve(SolveMethod::SUFFICIENT_STATISTICS), std::runtime_error);
+  EXPECT_THROW(solver.Solve(SolveMethod::FULL), std::runtime_error);
+}
+
+// A failed AddObservations stores nothing, so later observations may have a
+// different number of corners.
+TEST(Solver, ReferenceOutOfRangeLeavesSolverUnchanged)
+{
+  const Problem problem = MakeProblem(30, 20, 1e-3, 5);
+
+  Solver solver;
+  PairOptions options;
+  options.strategy = PairStrategy::REFERENCE;
+  options.reference = 50;
+  solver.SetPairOptions(options);
+  EXPECT_THROW(solver.AddObservations(problem.robposes, problem.campoints), std::out_of_range);
+  EXPECT_EQ(solver.NumPoses(), 0);
+  EXPECT_EQ(solver.NumPairs(), 0);
+
+  const Problem other = MakeProblem(30, 40, 1e-3, 6);
+  options.reference = 0;
+  solver.SetPairOptions(options);
+  solver.AddObservations(other.robposes, other.campoints);
+  EXPECT_EQ(solver.NumPoses(), 30);
+  EXPECT_EQ(solver.NumPairs(), 29);
+}
+
+auto SelectRows(const RowMatrixXd& matrix, const std::vector<int>& rows) -> RowMatrixXd
+{
+  RowMatrixXd selected(rows.size(), matrix.cols());
+  for (std::size_t k = 0; k < rows.size(); ++k)
+  {
+    selected.row(k) = matrix.row(rows[k]);
+  }
+  return selected;
+}
+
+class SlidingWindowTest : public ::testing::TestWithParam<PairStrategy>
+{
+};
+
+// Streams poses through a window, solving along the way so that pairs are
+// evicted from both the problem and the Gram matrix and the bookkeeping is
+// compacted, and compares the result with a solver given only the window.
+TEST_P(SlidingWindowTest, MatchesFreshSolverOnWindow)
+{
+  constexpr int kNumPoses = 60;
+  constexpr int kNumCorners = 20;
+  constexpr int kMaxPoses = 8;
+  const Problem problem = MakeProblem(kNumPoses, kNumCorners, 1e-3, 7);
+
+  PairOptions options;
+  options.strategy = GetParam();
+  const auto expected_pairs = [&](int num_poses) {
+    return options.strategy == PairStrategy::ALL ? num_poses * (num_poses - 1) / 2 : num_poses - 1;
+  };
+
+  // Near the solution, so both solvers converge to the same minimum.
+  const Eigen::Quaterniond q_true(problem.X.linear());
+  const Eigen::Quaterniond q_start = q_true * Eigen::Quaterniond(Eigen::AngleAxisd(0.05, Eigen::Vector3d::UnitX()));
+  const Eigen::Vector4d q_init(q_start.w(), q_start.x(), q_start.y(), q_start.z());
+  const Eigen::Vector3d t_init = problem.X.translation() + Eigen::Vector3d::Constant(0.01);
+
+  Solver streamed(q_init, t_init);
+  streamed.SetOptions(TightOptions());
+  streamed.SetPairOptions(options);
+  streamed.SetMaxPoses(kMaxPoses);
+  for (int k = 0; k < kNumPoses; ++k)
+  {
+    const Eigen::Matrix4d robpose = Eigen::Map<const Eigen::Matrix<double, 4, 4, Eigen::RowMajor>>(problem.robposes.row(k).data());
+    streamed.AddPose(robpose, Eigen::Map<const RowMatrixXd>(problem.campoints.row(k).data(), kNumCorners, 3));
+    ASSERT_EQ(streamed.NumPoses(), std::min(k + 1, kMaxPoses)) << "pose " << k;
+    ASSERT_EQ(streamed.NumPairs(), expected_pairs(std::min(k + 1, kMaxPoses))) << "pose " << k;
+    if (k > 0 && k % 5 == 0)
+    {
+      streamed.Solve(k % 10 == 0 ? SolveMethod::FULL : SolveMethod::SUFFICIENT_STATISTICS);
+    }
+  }
+  const auto [q_streamed, t_streamed] = streamed.Solve(SolveMethod::SUFFICIENT_STATISTICS);
+  // From the minimum, so that the fresh solver's initial cost compares the
+  // two Gram matrices at the same point.
+  streamed.Solve(SolveMethod::SUFFICIENT_STATISTICS);
+
+  // The reference pose, the first one, never leaves the window.
+  std::vector<int> window;
+  const int first = options.strategy == PairStrategy::REFERENCE ? kNumPoses - kMaxPoses + 1 : kNumPoses - kMaxPoses;
+  if (options.strategy == PairStrategy::REFERENCE)
+  {
+    window.push_back(0);
+  }
+  for (int k = first; k < kNumPoses; ++k)
+  {
+    window.push_back(k);
+  }
+
+  Solver fresh(q_streamed, t_streamed);
+  fresh.SetOptions(TightOptions());
+  fresh.SetPairOptions(options);
+  fresh.AddObservations(SelectRows(problem.robposes, window), SelectRows(problem.campoints, window));
+  ASSERT_EQ(fresh.NumPairs(), streamed.NumPairs());
+  const auto [q_fresh, t_fresh] = fresh.Solve(SolveMethod::SUFFICIENT_STATISTICS);
+
+  EXPECT_NEAR(streamed.Summary().initial_cost, fresh.Summary().initial_cost, 1e-8 * fresh.Summary().initial_cost);
+
+  EXPECT_LT(RotationAngle(q_streamed, q_fresh), 1e-7);
+  EXPECT_LT((t_streamed - t_fresh).norm(), 1e-7);
+  EXPECT_NEAR(streamed.Summary().final_cost, fresh.Summary().final_cost, 1e-6 * fresh.Summary().final_cost);
+}
+
+INSTANTIATE_TEST_SUITE_P(PairStrategies, SlidingWindowTest, ::testing::Values(PairStrategy::ALL, PairStrategy::CONSECUTIVE, PairStrategy::REFERENCE),
+                         [](const ::testing::TestParamInfo<PairStrategy>& info) {
+                           switch (info.param)
+                           {
+                             case PairStrategy::ALL:
+                               return "All";
+                             case PairStrategy::CONSECUTIVE:
+                               return "Consecutive";
+                             default:
+                               return "Reference";
+                           }
+                         });
+}  // namespace
+}  // namespace eris::hand_eye_calibration
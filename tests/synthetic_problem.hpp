@@ -0,0 +1,72 @@
+// Copyright 2020 Norwegian University of Science and Technology.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include <Eigen/Geometry>
+
+#include <cstdint>
+#include <random>
+
+#include <eris/solver.hpp>
+
+namespace eris::hand_eye_calibration
+{
+struct Problem
+{
+  RowMatrixXd robposes;
+  RowMatrixXd campoints;
+  Eigen::Isometry3d X;
+};
+
+inline auto RandomPose(std::mt19937& generator) -> Eigen::Isometry3d
+{
+  std::normal_distribution<double> normal;
+  Eigen::Isometry3d T = Eigen::Isometry3d::Identity();
+  T.linear() = Eigen::Quaterniond(normal(generator), normal(generator), normal(generator), normal(generator)).normalized().toRotationMatrix();
+  T.translation() << normal(generator), normal(generator), normal(generator);
+  return T;
+}
+
+// Eye-in-hand problem with a chessboard of 2 cm squares seen from random robot
+// poses, with Gaussian noise on the corners.
+inline auto MakeProblem(int num_poses, int num_corners, double noise, std::uint32_t seed) -> Problem
+{
+  std::mt19937 generator(seed);
+  std::normal_distribution<double> normal(0.0, noise);
+
+  Eigen::Matrix3Xd P(3, num_corners);
+  for (int k = 0; k < num_corners; ++k)
+  {
+    P.col(k) << 0.02 * (k % 10), 0.02 * (k / 10), 0.0;
+  }
+  const Eigen::Isometry3d T = RandomPose(generator);
+
+  Problem problem{ RowMatrixXd(num_poses, 16), RowMatrixXd(num_poses, 3 * num_corners), RandomPose(generator) };
+  for (int i = 0; i < num_poses; ++i)
+  {
+    const Eigen::Isometry3d A = RandomPose(generator);
+    const Eigen::Matrix<double, 4, 4, Eigen::RowMajor> robpose = A.matrix();
+    const Eigen::Matrix3Xd corners = (problem.X.inverse() * A.inverse() * T) * P;
+    problem.robposes.row(i) = Eigen::Map<const Eigen::Matrix<double, 1, 16>>(robpose.data());
+    for (int k = 0; k < num_corners; ++k)
+    {
+      for (int n = 0; n < 3; ++n)
+      {
+        problem.campoints(i, 3 * k + n) = corners(n, k) + normal(generator);
+      }
+    }
+  }
+  return problem;
+}
+}  // namespace eris::hand_eye_calibration